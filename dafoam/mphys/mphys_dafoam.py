@@ -261,6 +261,15 @@ class DAFoamSolver(ImplicitComponent):
         self.residualName = "%s_residuals" % self.discipline
         self.volCoordName = "%s_vol_coords" % self.discipline
 
+        # OpenMDAO calls solve_linear one output at a time, so the block GMRES is unsteady only
+        if DASolver.getOption("adjEqnOption")["useBlockGMRES"]:
+            om.issue_warning(
+                " useBlockGMRES is only used by the unsteady adjoint, the steady adjoint solves one output at a time!",
+                prefix="",
+                stacklevel=2,
+                category=om.OpenMDAOWarning,
+            )
+
         # initialize the dRdWT matrix-free matrix in DASolver
         DASolver.solverAD.initializedRdWTMatrixFree()
 
@@ -391,37 +400,24 @@ class DAFoamSolver(ImplicitComponent):
             # get the reverse mode AD seed from d_residuals
             seed = d_residuals[self.stateName]
 
-            # this computes [dRdW]^T*Psi using reverse mode AD
+            # this computes [dRdW]^T*Psi and [dRdX]^T*Psi using reverse mode AD
+            # NOTE: we register the states and all inputs in one tape, so one reverse sweep
+            # gives all the products
+            jacInputs = {}
             if self.stateName in d_outputs:
-                product = np.zeros(self.localAdjSize)
-                jacInput = outputs[self.stateName]
-                DASolver.solverAD.calcJacTVecProduct(
-                    self.stateName,
-                    "stateVar",
-                    jacInput,
-                    self.residualName,
-                    "residual",
-                    seed,
-                    product,
-                )
-                d_outputs[self.stateName] += product
+                jacInputs[self.stateName] = ["stateVar", outputs[self.stateName]]
 
-            # loop over all inputs keys and compute the matrix-vector products accordingly
             inputDict = DASolver.getOption("inputInfo")
             for inputName in list(inputs.keys()):
-                inputType = inputDict[inputName]["type"]
-                jacInput = inputs[inputName]
-                product = np.zeros_like(jacInput)
-                DASolver.solverAD.calcJacTVecProduct(
-                    inputName,
-                    inputType,
-                    jacInput,
-                    self.residualName,
-                    "residual",
-                    seed,
-                    product,
-                )
-                d_inputs[inputName] += product
+                jacInputs[inputName] = [inputDict[inputName]["type"], inputs[inputName]]
+
+            products = DASolver.calcJacTVecProducts(jacInputs, self.residualName, "residual", seed)
+
+            if self.stateName in d_outputs:
+                d_outputs[self.stateName] += products[self.stateName]
+
+            for inputName in list(inputs.keys()):
+                d_inputs[inputName] += products[inputName]
 
     def solve_linear(self, d_outputs, d_residuals, mode):
         # solve the adjoint equation [dRdW]^T * Psi = dFdW
@@ -495,6 +491,9 @@ class DAFoamSolver(ImplicitComponent):
                         if self.comm.rank == 0:
                             print("Driver total derivatives for iteration: %d" % self.solution_counter, flush=True)
                             print("---------------------------------------------", flush=True)
+                        # dump the cumulative profiling stats for this optimization iteration
+                        if DASolver.getOption("profiling")["writeJSON"]:
+                            DASolver.writeProfileJSON(self.solution_counter)
                         self.solution_counter += 1
 
                     # compute the preconditioner matrix for the adjoint linear equation solution
@@ -540,6 +539,9 @@ class DAFoamSolver(ImplicitComponent):
                     if self.comm.rank == 0:
                         print("Driver total derivatives for iteration: %d" % self.solution_counter, flush=True)
                         print("---------------------------------------------", flush=True)
+                    # dump the cumulative profiling stats for this optimization iteration
+                    if DASolver.getOption("profiling")["writeJSON"]:
+                        DASolver.writeProfileJSON(self.solution_counter)
                     self.solution_counter += 1
                 # solve the adjoint equation using the fixed-point adjoint approach
                 fail = DASolver.solverAD.runFPAdj(dFdW, self.psi)
@@ -755,35 +757,18 @@ class DAFoamFunctions(ExplicitComponent):
             if abs(seed) < 1e-12:
                 continue
 
+            # compute dFdW * seed and dFdX * seed for all inputs using one tape
+            jacInputs = {}
             for inputName in list(d_inputs.keys()):
-                # compute dFdW * seed
                 if inputName == self.stateName:
-                    jacInput = inputs[self.stateName]
-                    product = np.zeros_like(jacInput)
-                    DASolver.solverAD.calcJacTVecProduct(
-                        self.stateName,
-                        "stateVar",
-                        jacInput,
-                        functionName,
-                        "function",
-                        seed,
-                        product,
-                    )
-                    d_inputs[self.stateName] += product
+                    jacInputs[inputName] = ["stateVar", inputs[self.stateName]]
                 else:
-                    inputType = inputDict[inputName]["type"]
-                    jacInput = inputs[inputName]
-                    product = np.zeros_like(jacInput)
-                    DASolver.solverAD.calcJacTVecProduct(
-                        inputName,
-                        inputType,
-                        jacInput,
-                        functionName,
-                        "function",
-                        seed,
-                        product,
-                    )
-                    d_inputs[inputName] += product
+                    jacInputs[inputName] = [inputDict[inputName]["type"], inputs[inputName]]
+
+            products = DASolver.calcJacTVecProducts(jacInputs, functionName, "function", seed)
+
+            for inputName in list(d_inputs.keys()):
+                d_inputs[inputName] += products[inputName]
 
 
 class DAFoamWarper(ExplicitComponent):
@@ -907,33 +892,17 @@ class DAFoamThermal(ExplicitComponent):
         for outputName in list(d_outputs.keys()):
             seeds = d_outputs[outputName]
 
+            # compute the products for the states and volCoord using one tape
+            jacInputs = {}
             if self.stateName in d_inputs:
-                jacInput = inputs[self.stateName]
-                product = np.zeros_like(jacInput)
-                DASolver.solverAD.calcJacTVecProduct(
-                    self.stateName,
-                    "stateVar",
-                    jacInput,
-                    outputName,
-                    "thermalCouplingOutput",
-                    seeds,
-                    product,
-                )
-                d_inputs[self.stateName] += product
-
+                jacInputs[self.stateName] = ["stateVar", inputs[self.stateName]]
             if self.volCoordName in d_inputs:
-                jacInput = inputs[self.volCoordName]
-                product = np.zeros_like(jacInput)
-                DASolver.solverAD.calcJacTVecProduct(
-                    self.volCoordName,
-                    "volCoord",
-                    jacInput,
-                    outputName,
-                    "thermalCouplingOutput",
-                    seeds,
-                    product,
-                )
-                d_inputs[self.volCoordName] += product
+                jacInputs[self.volCoordName] = ["volCoord", inputs[self.volCoordName]]
+
+            products = DASolver.calcJacTVecProducts(jacInputs, outputName, "thermalCouplingOutput", seeds)
+
+            for inputName in list(jacInputs.keys()):
+                d_inputs[inputName] += products[inputName]
 
 
 class DAFoamFaceCoords(ExplicitComponent):
@@ -1060,33 +1029,17 @@ class DAFoamForces(ExplicitComponent):
         if "f_aero" in d_outputs:
             seeds = d_outputs["f_aero"]
 
+            # compute the products for the states and volCoord using one tape
+            jacInputs = {}
             if self.stateName in d_inputs:
-                jacInput = inputs[self.stateName]
-                product = np.zeros_like(jacInput)
-                DASolver.solverAD.calcJacTVecProduct(
-                    self.stateName,
-                    "stateVar",
-                    jacInput,
-                    self.outputName,
-                    "forceCouplingOutput",
-                    seeds,
-                    product,
-                )
-                d_inputs[self.stateName] += product
-
+                jacInputs[self.stateName] = ["stateVar", inputs[self.stateName]]
             if self.volCoordName in d_inputs:
-                jacInput = inputs[self.volCoordName]
-                product = np.zeros_like(jacInput)
-                DASolver.solverAD.calcJacTVecProduct(
-                    self.volCoordName,
-                    "volCoord",
-                    jacInput,
-                    self.outputName,
-                    "forceCouplingOutput",
-                    seeds,
-                    product,
-                )
-                d_inputs[self.volCoordName] += product
+                jacInputs[self.volCoordName] = ["volCoord", inputs[self.volCoordName]]
+
+            products = DASolver.calcJacTVecProducts(jacInputs, self.outputName, "forceCouplingOutput", seeds)
+
+            for inputName in list(jacInputs.keys()):
+                d_inputs[inputName] += products[inputName]
 
 
 class OptFuncs(object):
@@ -1477,6 +1430,17 @@ class DAFoamSolverUnsteady(ExplicitComponent):
 
         inputDict = DASolver.getOption("inputInfo")
 
+        # find the outputs that need the adjoint. If the seed is zero, we do not compute
+        # the adjoint for this output. NOTE: we solve the adjoints for all the outputs in the
+        # same backward time loop, so the states are read only once for each time step
+        adjOutputNames = []
+        for outputName in list(self.unsteadyCompOutput.keys()):
+            if np.linalg.norm(d_outputs[outputName]) >= 1e-12:
+                adjOutputNames.append(outputName)
+
+        # whether to solve the adjoint equations for all the outputs together using block GMRES
+        useBlockGMRES = self.adjEqnSolMethod == "Krylov" and DASolver.getOption("adjEqnOption")["useBlockGMRES"]
+
         # init the dFdW vec
         dFdW = PETSc.Vec().create(PETSc.COMM_WORLD)
         dFdW.setSizes((localAdjSize, PETSc.DECIDE), bsize=1)
@@ -1487,55 +1451,59 @@ class DAFoamSolverUnsteady(ExplicitComponent):
         psi = dFdW.duplicate()
         psi.zeroEntries()
 
-        # initialize the adjoint vecs
-        dRdW0TPsi = np.zeros(localAdjSize)
-        dRdW00TPsi = np.zeros(localAdjSize)
-        dRdW00TPsiBuffer = np.zeros(localAdjSize)
-        dFdWArray = np.zeros(localAdjSize)
-        psiArray = np.zeros(localAdjSize)
-        tempdFdWArray = np.zeros(localAdjSize)
+        # initialize the adjoint vecs and the total derivatives for each output
+        totals = {}
+        dRdW0TPsi = {}
+        dRdW00TPsi = {}
+        dRdW00TPsiBuffer = {}
+        psiArrays = {}
+        for outputName in adjOutputNames:
+            totals[outputName] = {}
+            for inputName in list(inputs.keys()):
+                totals[outputName][inputName] = np.zeros_like(inputs[inputName])
+            dRdW0TPsi[outputName] = np.zeros(localAdjSize)
+            dRdW00TPsi[outputName] = np.zeros(localAdjSize)
+            dRdW00TPsiBuffer[outputName] = np.zeros(localAdjSize)
+            psiArrays[outputName] = np.zeros(localAdjSize)
 
-        # loop over all function, calculate dFdW, and solve the adjoint
-        # for functionName in list(d_outputs.keys()):
-        for outputName in list(self.unsteadyCompOutput.keys()):
+        # loop over all time steps and solve the adjoint and accumulate the totals
+        adjointFail = 0
+        for n in range(endTimeIndex, 0, -1):
 
-            # we need to zero the total derivative for each function
-            totals = {}
-            for inputName in list(inputs.keys()):
-                totals[inputName] = np.zeros_like(inputs[inputName])
+            if len(adjOutputNames) == 0:
+                break
 
-            seed = d_outputs[outputName]
+            timeVal = n * deltaT
 
-            # if the seed is zero, do not compute the adjoint and pass to
-            # the next funnction
-            if np.linalg.norm(seed) < 1e-12:
-                continue
+            if self.comm.rank == 0:
+                print(
+                    "---- Solving unsteady adjoint for %s. t = %f ----" % (", ".join(adjOutputNames), timeVal),
+                    flush=True,
+                )
 
-            # zero the vecs
-            dRdW0TPsi[:] = 0.0
-            dRdW00TPsi[:] = 0.0
-            dRdW00TPsiBuffer[:] = 0.0
-            dFdW.zeroEntries()
+            # set the time value and index in the OpenFOAM layer. Note: this is critical
+            # because if timeIndex < 2, OpenFOAM will not use the oldTime.oldTime for 2nd
+            # ddtScheme and mess up the totals. Check backwardDdtScheme.C
+            DASolver.solver.setTime(timeVal, n)
+            DASolver.solverAD.setTime(timeVal, n)
+            # now we can read the variables
+            # read the state, state.oldTime, etc and update self.wVec for this time instance
+            DASolver.readStateVars(timeVal, deltaT)
+            # if it is dynamic mesh, read the mesh points
+            if DASolver.getOption("dynamicMesh")["active"]:
+                DASolver.readDynamicMeshPoints(timeVal, deltaT, n, ddtSchemeOrder)
 
-            # loop over all time steps and solve the adjoint and accumulate the totals
-            adjointFail = 0
-            for n in range(endTimeIndex, 0, -1):
-                timeVal = n * deltaT
+            # NOTE: we register the states and all inputs in one tape, so one reverse sweep
+            # gives both dFdW and dFdX for each function
+            jacInputs = {"states": ["stateVar", DASolver.getStates()]}
+            for inputName in list(inputs.keys()):
+                jacInputs[inputName] = [inputDict[inputName]["type"], inputs[inputName]]
 
-                if self.comm.rank == 0:
-                    print("---- Solving unsteady adjoint for %s. t = %f ----" % (outputName, timeVal), flush=True)
-
-                # set the time value and index in the OpenFOAM layer. Note: this is critical
-                # because if timeIndex < 2, OpenFOAM will not use the oldTime.oldTime for 2nd
-                # ddtScheme and mess up the totals. Check backwardDdtScheme.C
-                DASolver.solver.setTime(timeVal, n)
-                DASolver.solverAD.setTime(timeVal, n)
-                # now we can read the variables
-                # read the state, state.oldTime, etc and update self.wVec for this time instance
-                DASolver.readStateVars(timeVal, deltaT)
-                # if it is dynamic mesh, read the mesh points
-                if DASolver.getOption("dynamicMesh")["active"]:
-                    DASolver.readDynamicMeshPoints(timeVal, deltaT, n, ddtSchemeOrder)
+            dFdWArrays = {}
+            dFdXs = {}
+            for outputName in adjOutputNames:
+
+                seed = d_outputs[outputName]
 
                 # calculate dFd? scaling, if time index is within the unsteady objective function
                 # index range, prescribed in unsteadyAdjointDict, we calculate dFdW
@@ -1546,111 +1514,103 @@ class DAFoamSolverUnsteady(ExplicitComponent):
                 firstFunctionName = self.unsteadyCompOutput[outputName][0]
                 dFScaling = DASolver.solver.getdFScaling(firstFunctionName, n - 1)
 
-                # loop over all function for this output, compute their dFdW, and add them up to
-                # get the dFdW for this output
-                dFdWArray[:] = 0.0
+                # loop over all function for this output, compute their dFdW and dFdX, and add them up to
+                # get the dFdW and dFdX for this output
+                dFdWArray = np.zeros(localAdjSize)
+                dFdXs[outputName] = {}
+                for inputName in list(inputs.keys()):
+                    dFdXs[outputName][inputName] = np.zeros_like(inputs[inputName])
                 for functionName in self.unsteadyCompOutput[outputName]:
 
-                    # calculate dFdW
-                    jacInput = DASolver.getStates()
-                    DASolver.solverAD.calcJacTVecProduct(
-                        "states",
-                        "stateVar",
-                        jacInput,
-                        functionName,
-                        "function",
-                        seed,
-                        tempdFdWArray,  # NOTE: we just use tempdFdWArray to hold a temp dFdW for this function
-                    )
+                    products = DASolver.calcJacTVecProducts(jacInputs, functionName, "function", seed)
 
-                    dFdWArray += tempdFdWArray * dFScaling
+                    dFdWArray += products["states"] * dFScaling
+                    # we need to scale the dFdX for unsteady adjoint too
+                    for inputName in list(inputs.keys()):
+                        dFdXs[outputName][inputName] += products[inputName] * dFScaling
 
                 # do dFdW - dRdW0TPsi - dRdW00TPsi
                 if ddtSchemeOrder == 1:
-                    dFdWArray = dFdWArray - dRdW0TPsi
+                    dFdWArray = dFdWArray - dRdW0TPsi[outputName]
                 elif ddtSchemeOrder == 2:
-                    dFdWArray = dFdWArray - dRdW0TPsi - dRdW00TPsi
+                    dFdWArray = dFdWArray - dRdW0TPsi[outputName] - dRdW00TPsi[outputName]
                     # now copy the buffer vec dRdW00TPsiBuffer to dRdW00TPsi for the next time step
-                    dRdW00TPsi[:] = dRdW00TPsiBuffer
+                    dRdW00TPsi[outputName][:] = dRdW00TPsiBuffer[outputName]
                 else:
                     print("ddtSchemeOrder not valid!" % ddtSchemeOrder)
 
-                # check if we need to update the PC Mat vals or use the pre-computed PC matrix
-                if self.adjEqnSolMethod == "Krylov":
-                    if str(timeVal) in list(self.dRdWTPC.keys()):
-                        if self.comm.rank == 0:
-                            print("Using pre-computed KSP PC mat for %f" % timeVal, flush=True)
-                        PCMat = self.dRdWTPC[str(timeVal)]
-                        DASolver.solverAD.updateKSPPCMat(PCMat, ksp)
-                    if n % PCMatUpdateInterval == 0 and n < endTimeIndex:
-                        # udpate part of the PC mat
-                        if self.comm.rank == 0:
-                            print("Updating dRdWTPC mat value using OF fvMatrix", flush=True)
-                        DASolver.solver.calcPCMatWithFvMatrix(PCMat)
+                dFdWArrays[outputName] = dFdWArray
 
-                # now solve the adjoint eqn
-                DASolver.arrayVal2Vec(dFdWArray, dFdW)
+            # check if we need to update the PC Mat vals or use the pre-computed PC matrix
+            if self.adjEqnSolMethod == "Krylov":
+                if str(timeVal) in list(self.dRdWTPC.keys()):
+                    if self.comm.rank == 0:
+                        print("Using pre-computed KSP PC mat for %f" % timeVal, flush=True)
+                    PCMat = self.dRdWTPC[str(timeVal)]
+                    DASolver.solverAD.updateKSPPCMat(PCMat, ksp)
+                if n % PCMatUpdateInterval == 0 and n < endTimeIndex:
+                    # udpate part of the PC mat
+                    if self.comm.rank == 0:
+                        print("Updating dRdWTPC mat value using OF fvMatrix", flush=True)
+                    DASolver.solver.calcPCMatWithFvMatrix(PCMat)
+
+            # now solve the adjoint eqns
+            if useBlockGMRES:
+                # solve all the outputs together, they share the Krylov subspace and the dRdWT tape
+                adjointFail, psiList, convergence = DASolver.solveLinearEqnBlock(
+                    ksp,
+                    [dFdWArrays[outputName] for outputName in adjOutputNames],
+                    [psiArrays[outputName] for outputName in adjOutputNames],
+                )
+                for idxI, outputName in enumerate(adjOutputNames):
+                    psiArrays[outputName] = psiList[idxI]
+                    if convergence[idxI]["iters"] < 0 and self.comm.rank == 0:
+                        print("Adjoint for %s not converged at t = %f" % (outputName, timeVal), flush=True)
+            else:
+                for outputName in adjOutputNames:
+                    DASolver.arrayVal2Vec(dFdWArrays[outputName], dFdW)
+                    # psi from the previous time step is the initial guess if useNonZeroInitGuess is True
+                    DASolver.arrayVal2Vec(psiArrays[outputName], psi)
 
-                if self.adjEqnSolMethod == "Krylov":
-                    adjointFail = DASolver.solverAD.solveLinearEqn(ksp, dFdW, psi)
-                elif self.adjEqnSolMethod == "fixedPoint":
-                    adjointFail = DASolver.solverAD.solveAdjointFP(dFdW, psi)
+                    if self.adjEqnSolMethod == "Krylov":
+                        adjointFail = DASolver.solverAD.solveLinearEqn(ksp, dFdW, psi)
+                    elif self.adjEqnSolMethod == "fixedPoint":
+                        adjointFail = DASolver.solverAD.solveAdjointFP(dFdW, psi)
 
-                # if one adjoint solution fails, return immediate without solving for the rest of steps.
-                if adjointFail > 0:
-                    break
+                    DASolver.vecVal2Array(psi, psiArrays[outputName])
+
+                    if adjointFail > 0:
+                        break
+
+            # if one adjoint solution fails, return immediate without solving for the rest of steps.
+            if adjointFail > 0:
+                break
+
+            # calculate dRdX^T * psi for all inputs and outputs using one tape and a batch of seeds
+            jacInputs.pop("states")
+            dRdXTPsis = DASolver.calcJacTVecProducts(
+                jacInputs, "residual", "residual", [psiArrays[outputName] for outputName in adjOutputNames]
+            )
+
+            for idxI, outputName in enumerate(adjOutputNames):
 
                 # loop over all inputs and compute total derivs
                 for inputName in list(inputs.keys()):
-
-                    # calculate dFdX
-                    inputType = inputDict[inputName]["type"]
-                    jacInput = inputs[inputName]
-                    dFdX = np.zeros_like(jacInput)
-                    tempdFdX = np.zeros_like(jacInput)
-
-                    # loop over all function for this output, compute their dFdX, and add them up to
-                    # get the dFdX for this output
-                    for functionName in self.unsteadyCompOutput[outputName]:
-                        DASolver.solverAD.calcJacTVecProduct(
-                            inputName,
-                            inputType,
-                            jacInput,
-                            functionName,
-                            "function",
-                            seed,
-                            tempdFdX,
-                        )
-                        # we need to scale the dFdX for unsteady adjoint too
-                        dFdX += tempdFdX * dFScaling
-
-                    # calculate dRdX^T * psi
-                    dRdXTPsi = np.zeros_like(jacInput)
-                    DASolver.vecVal2Array(psi, psiArray)
-                    DASolver.solverAD.calcJacTVecProduct(
-                        inputName,
-                        inputType,
-                        jacInput,
-                        "residual",
-                        "residual",
-                        psiArray,
-                        dRdXTPsi,
-                    )
-
-                    # total derivative
-                    totals[inputName] += dFdX - dRdXTPsi
+                    totals[outputName][inputName] += dFdXs[outputName][inputName] - dRdXTPsis[inputName][idxI]
 
                 # we need to calculate dRdW0TPsi for the previous time step
+                psiArray = psiArrays[outputName]
                 if ddtSchemeOrder == 1:
-                    DASolver.solverAD.calcdRdWOldTPsiAD(1, psiArray, dRdW0TPsi)
+                    DASolver.solverAD.calcdRdWOldTPsiAD(1, psiArray, dRdW0TPsi[outputName])
                 elif ddtSchemeOrder == 2:
                     # do the same for the previous previous step, but we need to save it to a buffer vec
                     # because dRdW00TPsi will be used 2 steps before
-                    DASolver.solverAD.calcdRdWOldTPsiAD(1, psiArray, dRdW0TPsi)
-                    DASolver.solverAD.calcdRdWOldTPsiAD(2, psiArray, dRdW00TPsiBuffer)
+                    DASolver.solverAD.calcdRdWOldTPsiAD(1, psiArray, dRdW0TPsi[outputName])
+                    DASolver.solverAD.calcdRdWOldTPsiAD(2, psiArray, dRdW00TPsiBuffer[outputName])
 
+        for outputName in adjOutputNames:
             for inputName in list(inputs.keys()):
-                d_inputs[inputName] += totals[inputName]
+                d_inputs[inputName] += totals[outputName][inputName]
 
         # once the adjoint is done, we will assign OF fields with the endTime solution
         # so, if the next primal does not read fields from the 0 time, we will continue
@@ -1658,3 +1618,6 @@ class DAFoamSolverUnsteady(ExplicitComponent):
         DASolver.solver.setTime(endTime, endTimeIndex)
         DASolver.solverAD.setTime(endTime, endTimeIndex)
         DASolver.readStateVars(endTime, deltaT)
+
+        # print the memory usage and bytes read and written for the state store
+        DASolver.solver.printStateStoreStats()
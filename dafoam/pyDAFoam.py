@@ -17,6 +17,7 @@ import subprocess
 import os
 import sys
 import copy
+import json
 import shutil
 import numpy as np
 from mpi4py import MPI
@@ -286,6 +287,12 @@ class DAOPTION(object):
         ##        "periodicity": 0.1,
         ##        "eps": 10.0,
         ##        "scale": 10.0  # scale the source such the integral equals desired thrust
+        ##        "cutoffEps": 5.0,  # optional, only loop over the cells where the smoothing kernel
+        ##                           # is larger than exp(-cutoffEps^2), i.e., within cutoffEps * eps
+        ##                           # for the Gaussian kernels. The cells are cached and updated only
+        ##                           # when the mesh or the actuator location changes. Set it to 0 to
+        ##                           # loop over all cells. This applies to actuatorLine, actuatorPoint,
+        ##                           # and actuatorDisk with cylinderAnnulusSmooth
         ##    },
         ##    "gradP"
         ##    {
@@ -362,6 +369,12 @@ class DAOPTION(object):
         ## Options for unsteady adjoint. mode can be hybrid or timeAccurate
         ## Here nTimeInstances is the number of time instances and periodicity is the
         ## periodicity of flow oscillation (hybrid adjoint only)
+        ## stateStorage is where to save the state trajectory for the unsteady adjoint. Options are:
+        ## file: save the states to the time folders (default); memory: save the states in per-rank
+        ## memory buffers; checkpoint: save only nStateCheckpoints checkpoints in memory and
+        ## recompute the missing time steps during the adjoint (binomial schedule, PIMPLE solvers only)
+        ## stateStorageCompression is for memory and checkpoint. Options are: none (lossless), float
+        ## (single precision), and quantized (the max error is stateStorageRelTol * max(|state|))
         self.unsteadyAdjoint = {
             "mode": "None",
             "PCMatPrecomputeInterval": 100,
@@ -369,6 +382,10 @@ class DAOPTION(object):
             "reduceIO": True,
             "additionalOutput": ["None"],
             "readZeroFields": True,
+            "stateStorage": "file",
+            "stateStorageCompression": "none",
+            "stateStorageRelTol": 1e-6,
+            "nStateCheckpoints": 20,
         }
 
         ## The interval of recomputing the pre-conditioner matrix dRdWTPC for solveAdjoint
@@ -401,7 +418,11 @@ class DAOPTION(object):
         ## a full list of supported input features. There are two supported regression model types:
         ## neural network and radial basis function. We can shift and scale the inputs and outputs
         ## we can also prescribe a default output value. The default output will be used in resetting
-        ## when they are nan, inf, or out of the prescribe upper and lower bounds
+        ## when they are nan, inf, or out of the prescribe upper and lower bounds. For the neural network,
+        ## adPreaccumulation (default True) preaccumulates the per-cell Jacobian in the reverse-mode AD
+        ## tape, which reduces the tape memory for the regression model. It falls back to the normal tape
+        ## when the parameters are active in the tape (e.g., for dRdParameters) because each cell's
+        ## Jacobian would then be as large as the neuron operations
         self.regressionModel = {
             "active": False,
             # "model1": {
@@ -416,6 +437,7 @@ class DAOPTION(object):
             #    "outputUpperBound": 1e1,
             #    "outputLowerBound": -1e1,
             #    "activationFunction": "sigmoid",  # other options are relu and tanh
+            #    "adPreaccumulation": True,
             #    "printInputInfo": True,
             #    "defaultOutputValue": 1.0,
             # },
@@ -475,9 +497,39 @@ class DAOPTION(object):
         ## debugging the accuracy of partial computation, always set it to True
         self.adjUseColoring = True
 
+        ## The graph coloring options for the partial derivative computation.
+        ## strategy: the coloring strategy for the strictly local columns, i.e., the columns that only
+        ## appear in the rows owned by this processor. The inter-processor columns are always colored
+        ## with the parallel speculative algorithm. Options are:
+        ## "sweep": assign one color per sweep and resolve conflicts with random tiebreakers (default)
+        ## "natural": greedy (first-fit) coloring with the column order
+        ## "largestFirst": greedy coloring with decreasing distance-2 degree
+        ## "smallestLast": greedy coloring with the smallest-last ordering, usually gives the fewest colors
+        ## "incidenceDegree": greedy coloring with the incidence degree ordering
+        ## compareStrategies: run all the strategies, print their numbers of colors and coloring times,
+        ## and keep the coloring with the fewest colors
+        ## maxColors: the max number of coloring sweeps, if we end up having more colors, something is wrong
+        ## NOTE: the coloring file is named dRdWColoring_nProcs_hash.bin, where the hash depends on
+        ## the mesh connectivity, adjoint states, and the coloring strategy, so changing any of them
+        ## will recompute the coloring
+        self.adjColoringOption = {
+            "strategy": "sweep",
+            "compareStrategies": False,
+            "maxColors": 10000,
+        }
+
         ## The Petsc options for solving the adjoint linear equation. These options should work for
         ## most of the case. If the adjoint does not converge, try to increase pcFillLevel to 2, or
-        ## try "jacMatReOrdering": "nd"
+        ## try "jacMatReOrdering": "nd". If useBlockGMRES is True, the unsteady adjoint solves the
+        ## adjoint equations for all the outputs together using block GMRES, i.e., they share the
+        ## Krylov subspace, the dRdWT tape, and the preconditioner. The block Krylov basis has up to
+        ## gmresRestart * nOutputs vectors. NOTE: useBlockGMRES is for the unsteady adjoint
+        ## (DAFoamBuilderUnsteady) only. For steady cases, OpenMDAO calls the adjoint solver
+        ## one output at a time, so useBlockGMRES has no effect there. For adjEqnSolMethod =
+        ## fixedPoint, fpAcceleration can be none or anderson. The anderson option mixes each
+        ## fixed-point iteration with the previous fpAndersonDepth iterations (Anderson mixing) to
+        ## reduce the number of iterations; it stores 2 * fpAndersonDepth + 3 adjoint vectors.
+        ## fpAndersonMixing is the damping factor in (0, 1]
         self.adjEqnOption = {
             "globalPCIters": 0,
             "asmOverlap": 1,
@@ -491,11 +543,15 @@ class DAOPTION(object):
             "gmresTolDiff": 1.0e2,
             "useNonZeroInitGuess": False,
             "useMGSO": False,
+            "useBlockGMRES": False,
             "printInfo": 1,
             "fpMaxIters": 1000,
             "fpRelTol": 1e-6,
             "fpMinResTolDiff": 1.0e2,
             "fpPCUpwind": False,
+            "fpAcceleration": "none",
+            "fpAndersonDepth": 5,
+            "fpAndersonMixing": 1.0,
             "dynAdjustTol": False,
         }
 
@@ -605,6 +661,18 @@ class DAOPTION(object):
         ## Whether to use OpenFOAMs snGrad() function or to manually compute distance for wall interfaces
         self.wallDistanceMethod = "default"
 
+        ## Profile the hot paths such as primal iterations, residual evaluations, tape recording and
+        ## evaluation, coloring, the FD color loop, KSP setup and solution, and state I/O. The tape memory
+        ## size and statement count and the KSP and fixed-point adjoint iterations are also recorded.
+        ## The stats (min, max, and mean across all processors) can be obtained by calling
+        ## DASolver.getProfileStats().
+        ## If writeJSON is True, mphys_dafoam will dump the stats to profile_xxx.json for each
+        ## optimization iteration
+        self.profiling = {
+            "active": False,
+            "writeJSON": False,
+        }
+
         ## the component output for the unsteady solvers. This will be used in mphys_dafoam's
         ## DAFoamBuilderUnsteady to determine the component's output
         ##
@@ -1236,7 +1304,7 @@ class PYDAFOAM(object):
             self.solver.setTime(time_2, index_2)
             self.solver.readMeshPoints(time_2)
             self.solverAD.setTime(time_2, index_2)
-            self.solverAD.readMeshPoints(time_2)
+            self._readMeshPointsAD(time_2)
         else:
             raise Error("ddtSchemeOrder not supported")
 
@@ -1246,31 +1314,53 @@ class PYDAFOAM(object):
         self.solver.setTime(time_1, index_1)
         self.solver.readMeshPoints(time_1)
         self.solverAD.setTime(time_1, index_1)
-        self.solverAD.readMeshPoints(time_1)
+        self._readMeshPointsAD(time_1)
         # read timeVal points
         self.solver.setTime(timeVal, timeIndex)
         self.solver.readMeshPoints(timeVal)
         self.solverAD.setTime(timeVal, timeIndex)
-        self.solverAD.readMeshPoints(timeVal)
+        self._readMeshPointsAD(timeVal)
+
+    def _readMeshPointsAD(self, timeVal):
+        """
+        Read the mesh points for solverAD. If the states are not saved to files, only
+        self.solver has the mesh points in its state store, so we copy them to solverAD
+        """
+        if self.getOption("unsteadyAdjoint")["stateStorage"] == "file":
+            self.solverAD.readMeshPoints(timeVal)
+        else:
+            points = np.zeros(self.solver.getNLocalPoints() * 3)
+            self.solver.getOFMeshPoints(points)
+            self.solverAD.updateOFMesh(points)
 
     def readStateVars(self, timeVal, deltaT):
         """
         Read the state variables in to OpenFOAM's state fields
         """
 
-        # read current time
-        self.solver.readStateVars(timeVal, 0)
-        self.solverAD.readStateVars(timeVal, 0)
+        if self.getOption("unsteadyAdjoint")["stateStorage"] == "file":
+            # read current time
+            self.solver.readStateVars(timeVal, 0)
+            self.solverAD.readStateVars(timeVal, 0)
 
-        # read old time
-        t0 = timeVal - deltaT
-        self.solver.readStateVars(t0, 1)
-        self.solverAD.readStateVars(t0, 1)
+            # read old time
+            t0 = timeVal - deltaT
+            self.solver.readStateVars(t0, 1)
+            self.solverAD.readStateVars(t0, 1)
 
-        # read old old time
-        t00 = timeVal - 2 * deltaT
-        self.solver.readStateVars(t00, 2)
-        self.solverAD.readStateVars(t00, 2)
+            # read old old time
+            t00 = timeVal - 2 * deltaT
+            self.solver.readStateVars(t00, 2)
+            self.solverAD.readStateVars(t00, 2)
+        else:
+            # the states are saved in the memory of self.solver only (the primal is run
+            # by self.solver), so we read them to self.solver first and then copy them to solverAD
+            snapshot = np.zeros(self.solver.getStateSnapshotSize())
+            for timeLevel in range(3):
+                self.solver.readStateVars(timeVal - timeLevel * deltaT, timeLevel)
+            for timeLevel in range(3):
+                self.solver.getStateSnapshot(snapshot, timeLevel)
+                self.solverAD.setStateSnapshot(snapshot, timeLevel)
 
         # assign the state from OF field to wVec so that the wVec
         # is update to date for unsteady adjoint
@@ -1995,6 +2085,55 @@ class PYDAFOAM(object):
         if self.getOption("useAD")["mode"] in ["forward", "reverse"]:
             self.solverAD.updateDAOption(self.options)
 
+    def getProfileStats(self):
+        """
+        Get the profiling stats (min, max, and mean across all processors) for solver and solverAD.
+        NOTE: the stats are cumulative, call resetProfileStats to reset them. This function needs
+        to be called by all processors
+        """
+
+        if self.solverInitialized == 0:
+            raise Error("self._initSolver not called!")
+
+        stats = {"solver": self.solver.getProfileStats()}
+
+        if self.getOption("useAD")["mode"] in ["forward", "reverse"]:
+            stats["solverAD"] = self.solverAD.getProfileStats()
+
+        return stats
+
+    def resetProfileStats(self):
+        """
+        Reset the profiling stats for solver and solverAD
+        """
+
+        if self.solverInitialized == 0:
+            raise Error("self._initSolver not called!")
+
+        self.solver.resetProfileStats()
+
+        if self.getOption("useAD")["mode"] in ["forward", "reverse"]:
+            self.solverAD.resetProfileStats()
+
+    def writeProfileJSON(self, solutionCounter, fileName=None):
+        """
+        Write the profiling stats to a JSON file. The default file name is profile_xxx.json
+        where xxx is the solutionCounter, e.g., the optimization iteration.
+        This function needs to be called by all processors
+        """
+
+        stats = self.getProfileStats()
+
+        if fileName is None:
+            fileName = "profile_%03d.json" % solutionCounter
+
+        if self.comm.rank == 0:
+            stats["solutionCounter"] = solutionCounter
+            with open(fileName, "w") as f:
+                json.dump(stats, f, indent=4, sort_keys=True)
+
+        return stats
+
     def getNLocalAdjointStates(self):
         """
         Get number of local adjoint states
@@ -2007,6 +2146,111 @@ class PYDAFOAM(object):
         """
         return self.solver.getNLocalPoints()
 
+    def calcJacTVecProducts(self, jacInputs, outputName, outputType, seeds):
+        """
+        Compute the Jacobian-matrix-transposed and vector products [dOutput/dInput]^T * seed
+        for multiple inputs using solverAD. All the inputs are registered in one tape, so we
+        need only one reverse sweep for all of them. The tape is reused if this function is
+        called again with the same inputs, output, states, and mesh
+
+        Parameters
+        ----------
+        jacInputs : dict
+            The inputs, the key is the input name and the value is [inputType, inputArray]
+
+        outputName, outputType : str
+            The output name and type
+
+        seeds : numpy array or list of numpy arrays
+            The seed array. If a list is given, we compute the products for all the seeds in a batch
+
+        Returns
+        -------
+        products : dict
+            The products, the key is the input name. If seeds is a list, the value is a list of
+            products, one for each seed
+        """
+
+        if len(jacInputs) == 0:
+            return {}
+
+        isBatch = isinstance(seeds, list)
+        seedList = seeds if isBatch else [seeds]
+        nSeeds = len(seedList)
+
+        self.solverAD.clearJacTVecInputs()
+        for inputName, (inputType, inputArray) in jacInputs.items():
+            self.solverAD.addJacTVecInput(inputName, inputType, np.ascontiguousarray(inputArray, dtype="d"))
+
+        seedArray = np.ascontiguousarray(np.concatenate(seedList), dtype="d")
+        self.solverAD.calcJacTVecProductBatch(outputName, outputType, nSeeds, seedArray)
+
+        products = {}
+        for inputName, (inputType, inputArray) in jacInputs.items():
+            productList = []
+            for seedI in range(nSeeds):
+                product = np.zeros(len(inputArray))
+                self.solverAD.getJacTVecProduct(inputName, inputType, seedI, product)
+                productList.append(product)
+            products[inputName] = productList if isBatch else productList[0]
+
+        return products
+
+    def solveLinearEqnBlock(self, ksp, rhsArrays, solArrays=None):
+        """
+        Solve the adjoint linear equation [dRdW]^T * psi = rhs for multiple right-hand sides
+        using block GMRES in solverAD. All the columns share the Krylov subspace, the dRdWT tape,
+        and the preconditioner in ksp
+
+        Parameters
+        ----------
+        ksp : PETSc.KSP
+            The KSP object created by createMLRKSPMatrixFree
+
+        rhsArrays : list of numpy arrays
+            The right-hand-side arrays, e.g., dFdW for all functions
+
+        solArrays : list of numpy arrays
+            The initial guess, only used if useNonZeroInitGuess is True
+
+        Returns
+        -------
+        fail : int
+            1 if any column does not satisfy the tolerance, otherwise 0
+
+        psiArrays : list of numpy arrays
+            The solution arrays, one for each right-hand side
+
+        convergence : list of dict
+            The iterations (-1 if not converged), initResNorm, and finalResNorm for each column
+        """
+
+        nRHS = len(rhsArrays)
+        localAdjSize = self.getNLocalAdjointStates()
+
+        rhsArray = np.ascontiguousarray(np.concatenate(rhsArrays), dtype="d")
+        if solArrays is None:
+            solArray = np.zeros(nRHS * localAdjSize)
+        else:
+            solArray = np.ascontiguousarray(np.concatenate(solArrays), dtype="d")
+
+        fail = self.solverAD.solveLinearEqnBlock(ksp, nRHS, rhsArray, solArray)
+
+        iters = np.zeros(nRHS)
+        initResNorms = np.zeros(nRHS)
+        finalResNorms = np.zeros(nRHS)
+        self.solverAD.getLinearEqnBlockConvergence(iters, initResNorms, finalResNorms)
+
+        psiArrays = []
+        convergence = []
+        for k in range(nRHS):
+            psiArrays.append(solArray[k * localAdjSize : (k + 1) * localAdjSize].copy())
+            convergence.append(
+                {"iters": int(iters[k]), "initResNorm": initResNorms[k], "finalResNorm": finalResNorms[k]}
+            )
+
+        return fail, psiArrays, convergence
+
     def getStates(self):
         """
         Return the adjoint state array owns by this processor
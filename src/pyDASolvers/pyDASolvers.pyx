@@ -49,6 +49,11 @@ cdef extern from "DASolvers.H" namespace "Foam":
         int solvePrimal()
         void runColoring()
         void calcJacTVecProduct(char *, char *, double *, char *, char *, double *, double *)
+        void addJacTVecInput(char *, char *, double *)
+        void clearJacTVecInputs()
+        void calcJacTVecProductBatch(char *, char *, int, double *)
+        void getJacTVecProduct(char *, int, double *)
+        void invalidateJacTVecTape()
         int getInputSize(char *, char *)
         int getOutputSize(char *, char *)
         void calcOutput(char *, char *, double *)
@@ -61,6 +66,8 @@ cdef extern from "DASolvers.H" namespace "Foam":
         void createMLRKSPMatrixFree(PetscMat, PetscKSP)
         void updateKSPPCMat(PetscMat, PetscKSP)
         int solveLinearEqn(PetscKSP, PetscVec, PetscVec)
+        int solveLinearEqnBlock(PetscKSP, int, double *, double *)
+        void getLinearEqnBlockConvergence(double *, double *, double *)
         void calcdRdWOldTPsiAD(int, double *, double *)
         void updateOFFields(double *)
         void getOFFields(double *)
@@ -93,6 +100,13 @@ cdef extern from "DASolvers.H" namespace "Foam":
         void readStateVars(double, int)
         void readMeshPoints(double)
         void writeMeshPoints(double *, double)
+        int getStateSnapshotSize()
+        void getStateSnapshot(double *, int)
+        void setStateSnapshot(double *, int)
+        void printStateStoreStats()
+        void getProfileStats(object)
+        void printProfileStats()
+        void resetProfileStats()
         void calcPCMatWithFvMatrix(PetscMat, int)
         double getEndTime()
         double getDeltaT()
@@ -218,6 +232,28 @@ cdef class pyDASolvers:
             outputType.encode(),
             seeds_data, 
             product_data)
+
+    def addJacTVecInput(self, inputName, inputType, np.ndarray[double, ndim=1, mode="c"] inputs):
+        assert len(inputs) == self.getInputSize(inputName, inputType), "invalid input array size!"
+        cdef double *inputs_data = <double*>inputs.data
+        self._thisptr.addJacTVecInput(inputName.encode(), inputType.encode(), inputs_data)
+
+    def clearJacTVecInputs(self):
+        self._thisptr.clearJacTVecInputs()
+
+    def calcJacTVecProductBatch(self, outputName, outputType, nSeeds, np.ndarray[double, ndim=1, mode="c"] seeds):
+        outputSize = self.getOutputSize(outputName, outputType)
+        assert len(seeds) == nSeeds * outputSize, "invalid seed array size!"
+        cdef double *seeds_data = <double*>seeds.data
+        self._thisptr.calcJacTVecProductBatch(outputName.encode(), outputType.encode(), nSeeds, seeds_data)
+
+    def getJacTVecProduct(self, inputName, inputType, seedI, np.ndarray[double, ndim=1, mode="c"] product):
+        assert len(product) == self.getInputSize(inputName, inputType), "invalid product array size!"
+        cdef double *product_data = <double*>product.data
+        self._thisptr.getJacTVecProduct(inputName.encode(), seedI, product_data)
+
+    def invalidateJacTVecTape(self):
+        self._thisptr.invalidateJacTVecTape()
     
     def calcdRdWT(self, isPC, Mat dRdWT):
         self._thisptr.calcdRdWT(isPC, dRdWT.mat)
@@ -250,6 +286,26 @@ cdef class pyDASolvers:
     def solveLinearEqn(self, KSP myKSP, Vec rhsVec, Vec solVec):
         return self._thisptr.solveLinearEqn(myKSP.ksp, rhsVec.vec, solVec.vec)
     
+    def solveLinearEqnBlock(self,
+            KSP myKSP,
+            nRHS,
+            np.ndarray[double, ndim=1, mode="c"] rhsArray,
+            np.ndarray[double, ndim=1, mode="c"] solArray):
+        assert len(rhsArray) == nRHS * self.getNLocalAdjointStates(), "invalid rhs array size!"
+        assert len(solArray) == nRHS * self.getNLocalAdjointStates(), "invalid sol array size!"
+        cdef double *rhsArray_data = <double*>rhsArray.data
+        cdef double *solArray_data = <double*>solArray.data
+        return self._thisptr.solveLinearEqnBlock(myKSP.ksp, nRHS, rhsArray_data, solArray_data)
+    
+    def getLinearEqnBlockConvergence(self,
+            np.ndarray[double, ndim=1, mode="c"] iters,
+            np.ndarray[double, ndim=1, mode="c"] initResNorms,
+            np.ndarray[double, ndim=1, mode="c"] finalResNorms):
+        cdef double *iters_data = <double*>iters.data
+        cdef double *initResNorms_data = <double*>initResNorms.data
+        cdef double *finalResNorms_data = <double*>finalResNorms.data
+        self._thisptr.getLinearEqnBlockConvergence(iters_data, initResNorms_data, finalResNorms_data)
+    
     def updateOFFields(self, np.ndarray[double, ndim=1, mode="c"] states):
         assert len(states) == self.getNLocalAdjointStates(), "invalid array size!"
         cdef double *states_data = <double*>states.data
@@ -357,6 +413,33 @@ cdef class pyDASolvers:
         cdef double *points_data = <double*>points.data
 
         self._thisptr.writeMeshPoints(points_data, timeVal)
+
+    def getStateSnapshotSize(self):
+        return self._thisptr.getStateSnapshotSize()
+
+    def getStateSnapshot(self, np.ndarray[double, ndim=1, mode="c"] snapshot, timeLevel):
+        assert len(snapshot) == self.getStateSnapshotSize(), "invalid array size!"
+        cdef double *snapshot_data = <double*>snapshot.data
+        self._thisptr.getStateSnapshot(snapshot_data, timeLevel)
+
+    def setStateSnapshot(self, np.ndarray[double, ndim=1, mode="c"] snapshot, timeLevel):
+        assert len(snapshot) == self.getStateSnapshotSize(), "invalid array size!"
+        cdef double *snapshot_data = <double*>snapshot.data
+        self._thisptr.setStateSnapshot(snapshot_data, timeLevel)
+
+    def printStateStoreStats(self):
+        self._thisptr.printStateStoreStats()
+
+    def getProfileStats(self):
+        stats = {}
+        self._thisptr.getProfileStats(stats)
+        return stats
+
+    def printProfileStats(self):
+        self._thisptr.printProfileStats()
+
+    def resetProfileStats(self):
+        self._thisptr.resetProfileStats()
     
     def calcPCMatWithFvMatrix(self, Mat PCMat, turbOnly=0):
         self._thisptr.calcPCMatWithFvMatrix(PCMat.mat, turbOnly)
@@ -20,6 +20,7 @@ cdef extern from "UnitTests.H" namespace "Foam":
     cppclass UnitTests:
         UnitTests() except +
         void runDAUtilityTest1(char *, object)
+        double runDARegressionBenchmark(char *, object)
     
 # create python wrappers that call cpp functions
 cdef class pyUnitTests:
@@ -44,4 +45,7 @@ cdef class pyUnitTests:
     
     # wrap all the other member functions in the cpp class
     def runDAUtilityTest1(self, argsAll, pyOptions):
-        self._thisptr.runDAUtilityTest1(argsAll, pyOptions)
\ No newline at end of file
+        self._thisptr.runDAUtilityTest1(argsAll, pyOptions)
+    
+    def runDARegressionBenchmark(self, argsAll, pyOptions):
+        return self._thisptr.runDARegressionBenchmark(argsAll, pyOptions)
\ No newline at end of file
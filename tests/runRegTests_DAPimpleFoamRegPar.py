@@ -5,6 +5,8 @@ Run Python tests for optimization integration
 
 from mpi4py import MPI
 import os
+import copy
+import subprocess
 import numpy as np
 from testFuncs import *
 
@@ -17,22 +19,86 @@ from pygeo.mphys import OM_DVGEOCOMP
 
 gcomm = MPI.COMM_WORLD
 
+
+def runParallel(command):
+    """
+    Run an OpenFOAM utility with -parallel on gcomm.size processors from the root processor.
+    We remove the MPI environment variables of this job so that mpirun starts a new job
+    """
+    env = {key: val for key, val in os.environ.items() if not key.startswith(("OMPI_", "PMIX_", "PMI_"))}
+    subprocess.call("mpirun --oversubscribe -np %d %s -parallel" % (gcomm.size, command), shell=True, env=env)
+
+
+# the time series extracted by getProbeTimeSeries and getFieldRMSETimeSeries, the key is the output name
+timeSeriesCommands = {
+    "UProbe": "getProbeTimeSeries -coords '(0.5 0.5 0.5)' -varName U -varType vector",
+    "UDataProbe": "getProbeTimeSeries -coords '(0.5 0.5 0.5)' -varName UData -varType vector",
+    "UProbeBinary": "getProbeTimeSeries -coords '(0.5 0.5 0.5)' -varName UData -varType vector -binary",
+    "URMSE": "getFieldRMSETimeSeries -varName U -varType vector -fieldType volume",
+    "URMSEBinary": "getFieldRMSETimeSeries -varName U -varType vector -fieldType volume -binary",
+    "pRMSE": "getFieldRMSETimeSeries -varName p -varType scalar -fieldType surface -patchName walls",
+    "pRMSEBinary": "getFieldRMSETimeSeries -varName p -varType scalar -fieldType surface -patchName walls -binary",
+}
+
 os.chdir("./reg_test_files-main/ConvergentChannel")
 if gcomm.rank == 0:
-    os.system("rm -rf 0/* processor* *.bin")
+    os.system("rm -rf 0/* processor* *.bin constant/*.bin")
     os.system("cp -r constant/turbulenceProperties.sa constant/turbulenceProperties")
     os.system("cp -r 0.incompressible/* 0/")
     os.system("cp -r system.incompressible.unsteady/* system/")
     replace_text_in_file("system/fvSchemes", "meshWaveFrozen;", "meshWave;")
     os.system("pimpleFoam")
-    os.system("getFIData -refFieldName U -refFieldType vector")
-    os.system("getFIData -refFieldName p -refFieldType scalar")
-    os.system("getFIData -refFieldName wallShearStress -refFieldType vector")
+    for refFieldName, refFieldType in [["U", "vector"], ["p", "scalar"], ["wallShearStress", "vector"]]:
+        # the text ref data in the time folders and the binary ref data in constant/refFieldNameData.bin
+        os.system("getFIData -refFieldName %s -refFieldType %s" % (refFieldName, refFieldType))
+        os.system("getFIData -refFieldName %s -refFieldType %s -binary" % (refFieldName, refFieldType))
+    # the text UData at t = 0, the binary file already has it
+    os.system("getFIData -refFieldName U -refFieldType vector -time 0")
     # os.system("getFIData -refFieldName wallHeatFlux -refFieldType scalar")
-    # os.system("decomposePar -time '0:'")
+    # decompose the case and write the binary ref data for each processor. NOTE: pyDAFoam
+    # will find that the case is already decomposed and skip its decomposePar
+    f = open("system/decomposeParDict", "w")
+    f.write("FoamFile\n{\n    version 2.0;\n    format ascii;\n    class dictionary;\n")
+    f.write("    location system;\n    object decomposeParDict;\n}\n")
+    f.write("numberOfSubdomains %d;\nmethod scotch;\n" % gcomm.size)
+    f.close()
+    os.system("decomposePar -time '0:'")
+    runParallel("getFIData -refFieldName U -refFieldType vector -binary")
+    runParallel("getFIData -refFieldName p -refFieldType scalar -binary")
+    runParallel("getFIData -refFieldName wallShearStress -refFieldType vector -binary")
     os.system("cp constant/turbulenceProperties.sst constant/turbulenceProperties")
+    # rerun the primal with the sst model, so the time series of U and p differ from the ref data
+    # (sa model). We then only decompose the new fields to keep the binary ref data on each processor
+    os.system("pimpleFoam")
+    os.system("decomposePar -fields -time '0:'")
+    # extract the time series in serial and parallel, the results should be identical
+    for outputName, command in timeSeriesCommands.items():
+        os.system("%s -outputName %sSerial" % (command, outputName))
+        runParallel("%s -outputName %sParallel" % (command, outputName))
     # os.system("rm -rf 0.0* 0.1")
     replace_text_in_file("system/fvSchemes", "meshWave;", "meshWaveFrozen;")
+gcomm.Barrier()
+
+fail = 0
+if gcomm.rank == 0:
+    for outputName in timeSeriesCommands.keys():
+        serial = np.loadtxt("%sSerial.txt" % outputName)
+        parallel = np.loadtxt("%sParallel.txt" % outputName)
+        if serial.size == 0 or serial.shape != parallel.shape or not np.allclose(serial, parallel, 1e-5, 1e-12):
+            print("Time series %s in parallel differs from serial!" % outputName)
+            fail = 1
+        else:
+            print("Time series %s in parallel matches serial!" % outputName)
+    # the text and binary UData should give the same probe time series at the same times
+    text = np.loadtxt("UDataProbeSerial.txt")
+    binary = np.loadtxt("UProbeBinarySerial.txt")
+    if text.size == 0 or text.shape != binary.shape or not np.allclose(text, binary, 1e-5, 1e-12):
+        print("Time series UProbe from the binary file differs from the text file!")
+        fail = 1
+    else:
+        print("Time series UProbe from the binary file matches the text file!")
+if gcomm.bcast(fail, root=0):
+    exit(1)
 
 # aero setup
 U0 = 10.0
@@ -143,14 +209,23 @@ daOptions = {
 }
 
 
+# the same functions but read the ref data from the binary files
+daOptionsBinary = copy.deepcopy(daOptions)
+for funcName in daOptionsBinary["function"].keys():
+    daOptionsBinary["function"][funcName]["refDataFormat"] = "binary"
+
+
 class Top(Group):
+    def initialize(self):
+        self.options.declare("daOptions", default=daOptions, recordable=False)
+
     def setup(self):
 
         self.add_subsystem("dvs", om.IndepVarComp(), promotes=["*"])
 
         self.add_subsystem(
             "scenario",
-            DAFoamBuilderUnsteady(solver_options=daOptions, mesh_options=None),
+            DAFoamBuilderUnsteady(solver_options=self.options["daOptions"], mesh_options=None),
             promotes=["*"],
         )
 
@@ -186,6 +261,28 @@ funcNames = [
 # run the adjoint and forward ref
 run_tests(om, Top, gcomm, daOptions, funcNames, dvNames, dvIndices, funcDict, derivDict)
 
+# run the adjoint with the binary ref data, the function values and totals should be identical to
+# the ones with the text ref data
+prob = om.Problem()
+prob.model = Top(daOptions=daOptionsBinary)
+prob.setup(mode="rev")
+prob.run_model()
+totals = prob.compute_totals(of=funcNames)
+fail = 0
+if gcomm.rank == 0:
+    for funcName in funcNames:
+        valBinary = prob.get_val(funcName)
+        derivBinary = totals[(funcName, "dvs.reg_model")][0]
+        derivText = [derivDict[funcName]["reg_model%i-Adjoint" % index][0] for index in dvIndices[0]]
+        print("%s text: %s %s binary: %s %s" % (funcName, funcDict[funcName], derivText, valBinary, derivBinary))
+        if not np.allclose(valBinary, funcDict[funcName], 1e-12, 1e-16) or not np.allclose(
+            derivBinary, derivText, 1e-12, 1e-16
+        ):
+            print("refDataFormat binary test failed for %s!" % funcName)
+            fail = 1
+if gcomm.bcast(fail, root=0):
+    exit(1)
+
 # write the test results
 if gcomm.rank == 0:
     reg_write_dict(funcDict, 1e-10, 1e-12)
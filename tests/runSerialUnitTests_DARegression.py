@@ -0,0 +1,175 @@
+#!/usr/bin/env python
+"""
+Run the micro-benchmark for the neural network evaluation in DARegression, and check that
+the reverse-mode AD totals are the same with and without adPreaccumulation. The network parameters
+are design variables, so they are active in the dRdParameters tape, and we also benchmark the tape
+memory with and without adPreaccumulation
+"""
+
+from mpi4py import MPI
+import os
+import copy
+import numpy as np
+from testFuncs import *
+from dafoam.libs.pyUnitTests import pyUnitTests
+
+import openmdao.api as om
+from mphys.multipoint import Multipoint
+from dafoam.mphys import DAFoamBuilder
+from mphys.scenario_aerodynamic import ScenarioAerodynamic
+
+gcomm = MPI.COMM_WORLD
+
+os.chdir("./reg_test_files-main/ConvergentChannel")
+
+solverArg = "unitTests -python"
+
+solver = pyUnitTests()
+
+# the cells per second are printed for the cell-by-cell and the block evaluation
+for activationFunction in ["sigmoid", "tanh", "relu"]:
+    benchOptions = {
+        "hiddenLayerNeurons": [20, 20],
+        "activationFunction": activationFunction,
+        "nInputs": 9,
+        "nRepeats": 20,
+        "blockSize": 256,
+    }
+    cellsPerSec = solver.runDARegressionBenchmark(solverArg.encode(), benchOptions)
+    print("DARegression %s: %g cells/s" % (activationFunction, cellsPerSec))
+    if cellsPerSec < 0:
+        exit(1)
+
+# now check the AD derivatives of the neural network with and without adPreaccumulation
+if gcomm.rank == 0:
+    os.system("rm -rf 0/* processor* *.bin")
+    os.system("cp -r 0.incompressible/* 0/")
+    os.system("cp -r system.incompressible/* system/")
+    os.system("cp -r constant/turbulenceProperties.sa constant/turbulenceProperties")
+    replace_text_in_file("system/fvSchemes", "meshWave;", "meshWaveFrozen;")
+
+U0 = 10.0
+
+daOptions = {
+    "designSurfaces": ["walls"],
+    "solverName": "DASimpleFoam",
+    "primalMinResTol": 1.0e-12,
+    "primalMinResTolDiff": 1e4,
+    "primalBC": {
+        "U0": {"variable": "U", "patches": ["inlet"], "value": [U0, 0.0, 0.0]},
+        "p0": {"variable": "p", "patches": ["outlet"], "value": [0.0]},
+        "nuTilda0": {"variable": "nuTilda", "patches": ["inlet"], "value": [4.5e-5]},
+        "useWallFunction": False,
+        "transport:nu": 1.5e-5,
+    },
+    "regressionModel": {
+        "active": True,
+        "reg_model": {
+            "modelType": "neuralNetwork",
+            "inputNames": ["VoS", "PoD", "chiSA", "pGradStream", "PSoSS", "SCurv", "UOrth"],
+            "outputName": "betaFINuTilda",
+            "hiddenLayerNeurons": [5, 5],
+            "inputShift": [0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0],
+            "inputScale": [1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0],
+            "outputShift": 1.0,
+            "outputScale": 1.0,
+            "activationFunction": "tanh",
+            "adPreaccumulation": True,
+            "printInputInfo": False,
+            "outputUpperBound": 1e2,
+            "outputLowerBound": -1e2,
+            "defaultOutputValue": 1.0,
+        },
+    },
+    "function": {
+        "CD": {
+            "type": "force",
+            "source": "patchToFace",
+            "patches": ["walls"],
+            "directionMode": "fixedDirection",
+            "direction": [1.0, 0.0, 0.0],
+            "scale": 1.0,
+        },
+    },
+    "adjEqnOption": {"gmresRelTol": 1.0e-12, "pcFillLevel": 1, "jacMatReOrdering": "rcm"},
+    "normalizeStates": {"U": U0, "p": U0 * U0 / 2.0, "phi": 1.0, "nuTilda": 1e-3},
+    "inputInfo": {
+        "reg_model": {"type": "regressionPar", "components": ["solver", "function"]},
+    },
+    # we use the profiler to get the tape memory
+    "profiling": {"active": True, "writeJSON": False},
+}
+
+daOptionsNoPreacc = copy.deepcopy(daOptions)
+daOptionsNoPreacc["regressionModel"]["reg_model"]["adPreaccumulation"] = False
+
+
+def runAdjoint(options):
+
+    class Top(Multipoint):
+        def setup(self):
+            dafoam_builder = DAFoamBuilder(options, None, scenario="aerodynamic")
+            dafoam_builder.initialize(self.comm)
+
+            self.add_subsystem("dvs", om.IndepVarComp(), promotes=["*"])
+
+            self.mphys_add_scenario("scenario", ScenarioAerodynamic(aero_builder=dafoam_builder))
+
+        def configure(self):
+
+            nParameters = self.scenario.coupling.solver.DASolver.getNRegressionParameters("reg_model")
+            parameter0 = np.ones(nParameters) * 0.005
+            self.dvs.add_output("reg_model", val=parameter0)
+            self.connect("reg_model", "scenario.reg_model")
+
+            self.add_design_var("reg_model", lower=-100.0, upper=100.0, scaler=1.0)
+            self.add_objective("scenario.aero_post.CD", scaler=1.0)
+
+    prob = om.Problem()
+    prob.model = Top()
+    prob.setup(mode="rev")
+    prob.run_model()
+    CD = prob.get_val("scenario.aero_post.CD")
+
+    DASolver = prob.model.scenario.coupling.solver.DASolver
+    # only profile the AD tapes for the totals below
+    DASolver.resetProfileStats()
+    totals = prob.compute_totals()
+    stats = DASolver.getProfileStats()["solverAD"]
+
+    return CD, totals, stats
+
+
+CD, totals, stats = runAdjoint(daOptions)
+CDNoPreacc, totalsNoPreacc, statsNoPreacc = runAdjoint(daOptionsNoPreacc)
+
+tapeMemory = stats["metrics"]["tapeMemoryPeakMB"]["max"]
+tapeMemoryNoPreacc = statsNoPreacc["metrics"]["tapeMemoryPeakMB"]["max"]
+tapeTime = stats["phases"]["tapeEvaluate"]["time"]["max"]
+tapeTimeNoPreacc = statsNoPreacc["phases"]["tapeEvaluate"]["time"]["max"]
+print("DARegression adPreaccumulation on: tape memory peak %g MB, tapeEvaluate %g s" % (tapeMemory, tapeTime))
+print(
+    "DARegression adPreaccumulation off: tape memory peak %g MB, tapeEvaluate %g s"
+    % (tapeMemoryNoPreacc, tapeTimeNoPreacc)
+)
+
+# the preaccumulation falls back to the normal tape when the parameters are active, so it should
+# never need more tape memory than the normal tape
+if tapeMemory > 1.01 * tapeMemoryNoPreacc:
+    print("DARegression adPreaccumulation test failed! The preaccumulated tape is larger than the normal tape!")
+    exit(1)
+
+# the preaccumulation only changes how the per-cell Jacobian is stored in the tape, so the
+# function and the reverse-mode totals should be the same up to round-off
+print("CD adPreaccumulation on/off", CD, CDNoPreacc)
+if abs(CD[0] - CDNoPreacc[0]) / (abs(CDNoPreacc[0]) + 1e-16) > 1e-12:
+    print("DARegression adPreaccumulation test failed for CD!")
+    exit(1)
+for key in totalsNoPreacc.keys():
+    diff = np.max(np.abs(totals[key] - totalsNoPreacc[key]))
+    ref = max(np.max(np.abs(totalsNoPreacc[key])), 1e-16)
+    print(key, "relative difference", diff / ref)
+    if diff / ref > 1e-10:
+        print("DARegression adPreaccumulation test failed for derivatives!")
+        exit(1)
+print("DARegression adPreaccumulation test passed!")
@@ -0,0 +1,154 @@
+#!/usr/bin/env python
+"""
+Run the steady fixed-point adjoint (DASimpleFoam::runFPAdj) with and without Anderson mixing.
+Both should give the same totals, and Anderson mixing should need fewer fixed-point iterations
+"""
+
+from mpi4py import MPI
+import os
+import copy
+import numpy as np
+from testFuncs import *
+
+import openmdao.api as om
+from mphys.multipoint import Multipoint
+from dafoam.mphys import DAFoamBuilder
+from mphys.scenario_aerodynamic import ScenarioAerodynamic
+from pygeo.mphys import OM_DVGEOCOMP
+
+gcomm = MPI.COMM_WORLD
+
+os.chdir("./reg_test_files-main/NACA0012V4")
+if gcomm.rank == 0:
+    os.system("rm -rf 0 system processor* *.bin 0.0001")
+    os.system("cp -r 0.incompressible 0")
+    os.system("cp -r system.incompressible system")
+    os.system("cp -r constant/turbulenceProperties.safv3 constant/turbulenceProperties")
+    replace_text_in_file("system/fvSchemes", "meshWave;", "meshWaveFrozen;")
+
+# aero setup
+U0 = 10.0
+p0 = 0.0
+twist0 = 3.0
+
+daOptions = {
+    "designSurfaces": ["wing"],
+    "solverName": "DASimpleFoam",
+    "adjEqnSolMethod": "fixedPoint",
+    "primalMinResTol": 1.0e-10,
+    "primalMinResTolDiff": 1e4,
+    "primalBC": {
+        "U0": {"variable": "U", "patches": ["inout"], "value": [U0, 0.0, 0.0]},
+        "p0": {"variable": "p", "patches": ["inout"], "value": [p0]},
+        "useWallFunction": True,
+    },
+    "function": {
+        "CD": {
+            "type": "force",
+            "source": "patchToFace",
+            "patches": ["wing"],
+            "directionMode": "fixedDirection",
+            "direction": [1.0, 0.0, 0.0],
+            "scale": 1.0,
+        },
+        "CL": {
+            "type": "force",
+            "source": "patchToFace",
+            "patches": ["wing"],
+            "directionMode": "fixedDirection",
+            "direction": [0.0, 1.0, 0.0],
+            "scale": 1.0,
+        },
+    },
+    "adjEqnOption": {
+        "fpMaxIters": 1000,
+        "fpRelTol": 1e-6,
+        "fpAcceleration": "none",
+    },
+    "inputInfo": {
+        "aero_vol_coords": {"type": "volCoord", "components": ["solver", "function"]},
+    },
+    # we use the profiler to count the fixed-point iterations
+    "profiling": {"active": True, "writeJSON": False},
+}
+
+daOptionsAnderson = copy.deepcopy(daOptions)
+daOptionsAnderson["adjEqnOption"]["fpAcceleration"] = "anderson"
+daOptionsAnderson["adjEqnOption"]["fpAndersonDepth"] = 5
+daOptionsAnderson["adjEqnOption"]["fpAndersonMixing"] = 1.0
+
+meshOptions = {
+    "gridFile": os.getcwd(),
+    "fileType": "OpenFOAM",
+    # point and normal for the symmetry plane
+    "symmetryPlanes": [[[0.0, 0.0, 0.0], [0.0, 0.0, 1.0]], [[0.0, 0.0, 0.1], [0.0, 0.0, 1.0]]],
+}
+
+
+def runAdjoint(options):
+
+    class Top(Multipoint):
+        def setup(self):
+            dafoam_builder = DAFoamBuilder(options, meshOptions, scenario="aerodynamic")
+            dafoam_builder.initialize(self.comm)
+
+            self.add_subsystem("dvs", om.IndepVarComp(), promotes=["*"])
+            self.add_subsystem("mesh", dafoam_builder.get_mesh_coordinate_subsystem())
+            self.add_subsystem("geometry", OM_DVGEOCOMP(file="FFD/wingFFD.xyz", type="ffd"))
+
+            self.mphys_add_scenario("cruise", ScenarioAerodynamic(aero_builder=dafoam_builder))
+
+            self.connect("mesh.x_aero0", "geometry.x_aero_in")
+            self.connect("geometry.x_aero0", "cruise.x_aero")
+
+        def configure(self):
+
+            points = self.mesh.mphys_get_surface_mesh()
+            self.geometry.nom_add_discipline_coords("aero", points)
+            self.geometry.nom_addRefAxis(name="wingAxis", xFraction=0.25, alignIndex="k")
+
+            def twist(val, geo):
+                for i in range(2):
+                    geo.rot_z["wingAxis"].coef[i] = -val[0]
+
+            self.geometry.nom_addGlobalDV(dvName="twist", value=np.ones(1) * twist0, func=twist)
+
+            self.dvs.add_output("twist", val=np.ones(1) * twist0)
+            self.connect("twist", "geometry.twist")
+
+            self.add_design_var("twist", lower=-10.0, upper=10.0, scaler=1.0)
+            self.add_objective("cruise.aero_post.CD", scaler=1.0)
+            self.add_constraint("cruise.aero_post.CL", equals=0.3)
+
+    prob = om.Problem()
+    prob.model = Top()
+    prob.setup(mode="rev")
+    prob.run_model()
+
+    DASolver = prob.model.cruise.coupling.solver.DASolver
+    # only count the iterations for the adjoint solutions below
+    DASolver.resetProfileStats()
+    totals = prob.compute_totals()
+    fpIters = DASolver.getProfileStats()["solverAD"]["metrics"]["fpIterations"]["max"]
+
+    return totals, fpIters
+
+
+totals, fpIters = runAdjoint(daOptions)
+totalsAnderson, fpItersAnderson = runAdjoint(daOptionsAnderson)
+
+print("Fixed-point iterations: %d (relaxation) %d (Anderson)" % (fpIters, fpItersAnderson))
+
+# both adjoints are converged to fpRelTol, so the totals should be the same
+for key in totals.keys():
+    diff = np.max(np.abs(totals[key] - totalsAnderson[key]))
+    ref = max(np.max(np.abs(totals[key])), 1e-16)
+    if diff / ref > 1e-4:
+        print("DASimpleFoamFPAnderson test failed! Totals differ for %s" % str(key))
+        exit(1)
+
+if fpItersAnderson <= 0 or fpItersAnderson >= fpIters:
+    print("DASimpleFoamFPAnderson test failed! Anderson mixing did not reduce the fixed-point iterations")
+    exit(1)
+
+print("DASimpleFoamFPAnderson test passed!")
@@ -80,6 +80,16 @@ daOptions = {
             "scale": 0.1,
         },
     },
+    "adjEqnOption": {"gmresRelTol": 1.0e-10, "pcFillLevel": 1, "jacMatReOrdering": "rcm"},
+    "normalizeStates": {"U": U0, "p": U0 * U0 / 2.0, "phi": 1.0, "nuTilda": 1e-3},
+    "inputInfo": {
+        "actuator_disk": {
+            "type": "fvSourcePar",
+            "fvSourceName": "disk2",
+            "indices": [0, 7],  # centerX, outerRadius
+            "components": ["solver", "function"],
+        },
+    },
 }
 
 
@@ -87,8 +97,19 @@ class Top(Multipoint):
     def setup(self):
         dafoam_builder = DAFoamBuilder(daOptions, None, scenario="aerodynamic")
         dafoam_builder.initialize(self.comm)
+
+        self.add_subsystem("dvs", om.IndepVarComp(), promotes=["*"])
+
         self.mphys_add_scenario("cruise", ScenarioAerodynamic(aero_builder=dafoam_builder))
 
+    def configure(self):
+
+        self.dvs.add_output("actuator_disk", val=np.array([0.5, 0.4]))
+        self.connect("actuator_disk", "cruise.actuator_disk")
+
+        self.add_design_var("actuator_disk", lower=-50.0, upper=50.0, scaler=1.0)
+        self.add_objective("cruise.aero_post.CD", scaler=1.0)
+
 
 prob = om.Problem()
 prob.model = Top()
@@ -96,6 +117,7 @@ prob.setup(mode="rev")
 om.n2(prob, show_browser=False, outfile="mphys_aero.html")
 prob.run_model()
 CD = prob.get_val("cruise.aero_post.CD")
+totals = prob.compute_totals()
 
 
 print("CD", CD)
@@ -104,3 +126,26 @@ if (abs(CD - 2.4300457) / (CD + 1e-16)) > 1e-6:
     exit(1)
 else:
     print("ActuatorDisk test passed!")
+
+# now loop over all cells by setting cutoffEps = 0 and verify that the candidate cells
+# give the same function and AD derivatives as the full loop. Only disk2 (cylinderAnnulusSmooth)
+# uses the candidate cells, but we set cutoffEps for both disks
+for fvSourceName in daOptions["fvSource"].keys():
+    daOptions["fvSource"][fvSourceName]["cutoffEps"] = 0.0
+probFull = om.Problem()
+probFull.model = Top()
+probFull.setup(mode="rev")
+probFull.run_model()
+CDFull = probFull.get_val("cruise.aero_post.CD")
+totalsFull = probFull.compute_totals()
+
+print("CD full loop", CDFull)
+if (abs(CD - CDFull) / (abs(CDFull) + 1e-16)) > 1e-10:
+    print("ActuatorDisk cutoffEps test failed for CD!")
+    exit(1)
+for key in totalsFull.keys():
+    print(key, totals[key], totalsFull[key])
+    if np.max(np.abs(totals[key] - totalsFull[key])) > 1e-8 * (np.max(np.abs(totalsFull[key])) + 1e-16):
+        print("ActuatorDisk cutoffEps test failed for derivatives!")
+        exit(1)
+print("ActuatorDisk cutoffEps test passed!")
@@ -150,6 +150,7 @@ prob.setup(mode="rev")
 om.n2(prob, show_browser=False, outfile="mphys_aero.html")
 prob.run_model()
 CD = prob.get_val("CD")
+totals = prob.compute_totals()
 
 print("CD", CD)
 if (abs(CD - 28.42914855) / (CD + 1e-16)) > 1e-8:
@@ -157,3 +158,25 @@ if (abs(CD - 28.42914855) / (CD + 1e-16)) > 1e-8:
     exit(1)
 else:
     print("ActuatorLine test passed!")
+
+# now loop over all cells by setting cutoffEps = 0 and verify that the candidate cells
+# give the same function and AD derivatives as the full loop
+for fvSourceName in daOptions["fvSource"].keys():
+    daOptions["fvSource"][fvSourceName]["cutoffEps"] = 0.0
+probFull = om.Problem()
+probFull.model = Top()
+probFull.setup(mode="rev")
+probFull.run_model()
+CDFull = probFull.get_val("CD")
+totalsFull = probFull.compute_totals()
+
+print("CD full loop", CDFull)
+if (abs(CD - CDFull) / (abs(CDFull) + 1e-16)) > 1e-10:
+    print("ActuatorPoint cutoffEps test failed for CD!")
+    exit(1)
+for key in totalsFull.keys():
+    print(key, totals[key], totalsFull[key])
+    if np.max(np.abs(totals[key] - totalsFull[key])) > 1e-8 * (np.max(np.abs(totalsFull[key])) + 1e-16):
+        print("ActuatorPoint cutoffEps test failed for derivatives!")
+        exit(1)
+print("ActuatorPoint cutoffEps test passed!")
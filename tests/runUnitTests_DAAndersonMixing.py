@@ -0,0 +1,111 @@
+#!/usr/bin/env python
+"""
+Run the unsteady fixed-point adjoint with and without Anderson mixing and check that
+both give the same totals
+"""
+
+from mpi4py import MPI
+import os
+import copy
+import numpy as np
+from testFuncs import *
+
+import openmdao.api as om
+from openmdao.api import Group
+from dafoam.mphys.mphys_dafoam import DAFoamBuilderUnsteady
+
+gcomm = MPI.COMM_WORLD
+
+os.chdir("./reg_test_files-main/ConvergentChannel")
+if gcomm.rank == 0:
+    os.system("rm -rf 0/* processor* *.bin")
+    os.system("cp -r 0.incompressible/* 0/")
+    os.system("cp -r system.incompressible.unsteady/* system/")
+    os.system("cp -r constant/turbulenceProperties.sa constant/turbulenceProperties")
+    replace_text_in_file("system/fvSchemes", "meshWave;", "meshWaveFrozen;")
+
+daOptions = {
+    "designSurfaces": ["walls"],
+    "solverName": "DAPimpleFoam",
+    "useAD": {"mode": "reverse"},
+    "primalBC": {
+        "useWallFunction": False,
+    },
+    "adjEqnSolMethod": "fixedPoint",
+    "unsteadyAdjoint": {
+        "mode": "timeAccurate",
+        "readZeroFields": True,
+    },
+    "function": {
+        "CD": {
+            "type": "force",
+            "source": "patchToFace",
+            "patches": ["walls"],
+            "directionMode": "fixedDirection",
+            "direction": [1.0, 0.0, 0.0],
+            "scale": 1.0,
+            "timeOp": "average",
+        },
+    },
+    "adjStateOrdering": "cell",
+    "adjEqnOption": {
+        "fpRelaxP": 0.9,
+        "fpMaxIters": 200,
+        "fpRelTol": 1e-8,
+    },
+    "inputInfo": {
+        "patchV": {
+            "type": "patchVelocity",
+            "patches": ["inlet"],
+            "flowAxis": "x",
+            "normalAxis": "y",
+            "components": ["solver", "function"],
+        },
+    },
+    "unsteadyCompOutput": {
+        "CD": ["CD"],
+    },
+}
+
+
+def runAdjoint(options):
+
+    class Top(Group):
+        def setup(self):
+            self.add_subsystem("dvs", om.IndepVarComp(), promotes=["*"])
+            self.add_subsystem(
+                "cruise",
+                DAFoamBuilderUnsteady(solver_options=options, mesh_options=None),
+                promotes=["*"],
+            )
+
+        def configure(self):
+            self.dvs.add_output("patchV", val=np.array([10.0, 0.0]))
+            self.add_design_var("patchV", indices=[0], lower=-50.0, upper=50.0, scaler=1.0)
+            self.add_objective("CD", scaler=1.0)
+
+    prob = om.Problem()
+    prob.model = Top()
+    prob.setup(mode="rev")
+    prob.run_model()
+    totals = prob.compute_totals()
+    return totals
+
+
+totalsRef = runAdjoint(daOptions)
+
+daOptionsAnderson = copy.deepcopy(daOptions)
+daOptionsAnderson["adjEqnOption"]["fpAcceleration"] = "anderson"
+daOptionsAnderson["adjEqnOption"]["fpAndersonDepth"] = 5
+totals = runAdjoint(daOptionsAnderson)
+
+for key in totalsRef.keys():
+    diff = np.max(np.abs(totals[key] - totalsRef[key]))
+    ref = max(np.max(np.abs(totalsRef[key])), 1e-16)
+    if gcomm.rank == 0:
+        print("Totals %s: fixed-point %s, Anderson %s" % (str(key), totalsRef[key], totals[key]))
+    if diff / ref > 1e-5:
+        print("DAAndersonMixing test failed! Totals differ: %s" % str(key))
+        exit(1)
+
+print("DAAndersonMixing test passed!")
@@ -0,0 +1,148 @@
+#!/usr/bin/env python
+"""
+Run Python tests for the dRdW coloring strategies. We run the adjoint with each
+adjColoringOption-strategy and check that the coloring is valid (DAColoring::validateColoring
+aborts if two columns in the same row share a color) and all the strategies give the same
+totals. With adjColoringOption-compareStrategies, the coloring with the fewest colors should be used
+"""
+
+from mpi4py import MPI
+import os
+import glob
+import copy
+import numpy as np
+from testFuncs import *
+
+import openmdao.api as om
+from mphys.multipoint import Multipoint
+from dafoam.mphys import DAFoamBuilder
+from mphys.scenario_aerodynamic import ScenarioAerodynamic
+
+gcomm = MPI.COMM_WORLD
+
+os.chdir("./reg_test_files-main/ConvergentChannel")
+if gcomm.rank == 0:
+    os.system("rm -rf 0/* processor* *.bin")
+    os.system("cp -r 0.incompressible/* 0/")
+    os.system("cp -r system.incompressible/* system/")
+    os.system("cp -r constant/turbulenceProperties.sa constant/turbulenceProperties")
+    replace_text_in_file("system/fvSchemes", "meshWave;", "meshWaveFrozen;")
+
+daOptions = {
+    "designSurfaces": ["walls"],
+    "solverName": "DASimpleFoam",
+    "primalMinResTol": 1.0e-12,
+    "primalMinResTolDiff": 1e4,
+    "primalBC": {
+        "U0": {"variable": "U", "patches": ["inlet"], "value": [10.0, 0.0, 0.0]},
+        "p0": {"variable": "p", "patches": ["outlet"], "value": [0.0]},
+        "nuTilda0": {"variable": "nuTilda", "patches": ["inlet"], "value": [4.5e-5]},
+        "useWallFunction": False,
+        "transport:nu": 1.5e-5,
+    },
+    "function": {
+        "CD": {
+            "type": "force",
+            "source": "patchToFace",
+            "patches": ["walls"],
+            "directionMode": "fixedDirection",
+            "direction": [1.0, 0.0, 0.0],
+            "scale": 1.0,
+        },
+    },
+    "adjEqnOption": {"gmresRelTol": 1.0e-10, "pcFillLevel": 1, "jacMatReOrdering": "rcm"},
+    "normalizeStates": {"U": 10.0, "p": 50.0, "phi": 1.0, "nuTilda": 1e-3},
+    "inputInfo": {
+        "patchV": {
+            "type": "patchVelocity",
+            "patches": ["inlet"],
+            "flowAxis": "x",
+            "normalAxis": "y",
+            "components": ["solver", "function"],
+        },
+    },
+    # we use the profiler to get the number of colors
+    "profiling": {"active": True, "writeJSON": False},
+}
+
+
+def runColoring(strategy, compareStrategies=False):
+
+    options = copy.deepcopy(daOptions)
+    options["adjColoringOption"] = {"strategy": strategy, "compareStrategies": compareStrategies}
+
+    class Top(Multipoint):
+        def setup(self):
+            dafoam_builder = DAFoamBuilder(options, None, scenario="aerodynamic")
+            dafoam_builder.initialize(self.comm)
+
+            self.add_subsystem("dvs", om.IndepVarComp(), promotes=["*"])
+
+            self.mphys_add_scenario("cruise", ScenarioAerodynamic(aero_builder=dafoam_builder))
+
+        def configure(self):
+            self.dvs.add_output("patchV", val=np.array([10.0, 0.0]))
+            self.connect("patchV", "cruise.patchV")
+
+            self.add_design_var("patchV", lower=-100.0, upper=100.0, scaler=1.0)
+            self.add_objective("cruise.aero_post.CD", scaler=1.0)
+
+    # remove the coloring files so that the coloring is recomputed
+    if gcomm.rank == 0:
+        os.system("rm -rf processor* *.bin")
+    gcomm.Barrier()
+
+    prob = om.Problem()
+    prob.model = Top()
+    prob.setup(mode="rev")
+    prob.run_model()
+    totals = prob.compute_totals()
+
+    DASolver = prob.model.cruise.coupling.solver.DASolver
+    nColors = DASolver.getProfileStats()["solver"]["metrics"]["nColors"]["max"]
+
+    # the coloring file is only written after validateColoring passes
+    if len(glob.glob("dRdWColoring_%d_*.bin" % gcomm.size)) != 1:
+        print("DAColoring test failed for %s! The coloring file is not written!" % strategy)
+        exit(1)
+
+    if gcomm.rank == 0:
+        print("Coloring strategy %s: nColors %d" % (strategy, nColors))
+
+    return totals, nColors
+
+
+totalsSweep, nColorsSweep = runColoring("sweep")
+nColorsAll = [nColorsSweep]
+
+for strategy in ["natural", "largestFirst", "smallestLast", "incidenceDegree"]:
+    totals, nColors = runColoring(strategy)
+
+    # the greedy orderings have no guaranteed bound relative to sweep, so we only print the
+    # number of colors here
+    if nColors <= 0:
+        print("DAColoring test failed for %s! nColors %d sweep nColors %d" % (strategy, nColors, nColorsSweep))
+        exit(1)
+    nColorsAll.append(nColors)
+
+    # the coloring only changes the order of the FD perturbations, so the totals should not change
+    for key in totalsSweep.keys():
+        diff = np.max(np.abs(totals[key] - totalsSweep[key]))
+        ref = max(np.max(np.abs(totalsSweep[key])), 1e-16)
+        if diff / ref > 1e-8:
+            print("DAColoring test failed for %s! Totals differ from sweep: %s" % (strategy, str(key)))
+            exit(1)
+
+# compareStrategies runs all the strategies and keeps the coloring with the fewest colors
+totalsBest, nColorsBest = runColoring("smallestLast", compareStrategies=True)
+if nColorsBest != min(nColorsAll):
+    print("DAColoring test failed for compareStrategies! nColors %d expected %d" % (nColorsBest, min(nColorsAll)))
+    exit(1)
+for key in totalsSweep.keys():
+    diff = np.max(np.abs(totalsBest[key] - totalsSweep[key]))
+    ref = max(np.max(np.abs(totalsSweep[key])), 1e-16)
+    if diff / ref > 1e-8:
+        print("DAColoring test failed for compareStrategies! Totals differ from sweep: %s" % str(key))
+        exit(1)
+
+print("DAColoring test passed!")
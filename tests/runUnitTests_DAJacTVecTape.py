@@ -0,0 +1,210 @@
+#!/usr/bin/env python
+"""
+Run Python tests for the jacTVec tape reuse with two DASolver instances (aero and thermal)
+that share the same global AD tape in one process
+"""
+
+from mpi4py import MPI
+import os
+import numpy as np
+from testFuncs import *
+
+import openmdao.api as om
+from mphys.multipoint import Multipoint
+from mphys.utils.directory_utils import cd
+from dafoam.mphys import DAFoamBuilder
+from funtofem.mphys import MeldThermalBuilder
+from mphys.scenario_aerothermal import ScenarioAeroThermal
+
+gcomm = MPI.COMM_WORLD
+
+os.chdir("./reg_test_files-main/ChannelConjugateHeatV4")
+if gcomm.rank == 0:
+    os.system("rm -rf */processor*")
+
+# aero setup
+U0 = 10.0
+
+daOptionsAero = {
+    "designSurfaces": [
+        "hot_air_inner",
+        "hot_air_outer",
+        "hot_air_sides",
+        "cold_air_outer",
+        "cold_air_inner",
+        "cold_air_sides",
+    ],
+    "solverName": "DASimpleFoam",
+    "primalMinResTol": 1.0e-12,
+    "primalMinResTolDiff": 1.0e12,
+    "discipline": "aero",
+    "primalBC": {
+        "UHot": {"variable": "U", "patches": ["hot_air_in"], "value": [U0, 0.0, 0.0]},
+        "UCold": {"variable": "U", "patches": ["cold_air_in"], "value": [-U0, 0.0, 0.0]},
+        "useWallFunction": False,
+    },
+    "function": {
+        "HFH": {
+            "type": "wallHeatFlux",
+            "source": "patchToFace",
+            "patches": ["hot_air_inner"],
+            "scale": 1,
+        },
+    },
+    "normalizeStates": {
+        "U": U0,
+        "p": U0 * U0 / 2.0,
+        "nuTilda": 1e-3,
+        "T": 300,
+        "phi": 1.0,
+    },
+    "inputInfo": {
+        "aero_vol_coords": {"type": "volCoord", "components": ["solver", "function"]},
+        "T_convect": {
+            "type": "thermalCouplingInput",
+            "patches": ["hot_air_inner", "cold_air_outer"],
+            "components": ["solver", "function"],
+        },
+    },
+    "outputInfo": {
+        "q_convect": {
+            "type": "thermalCouplingOutput",
+            "patches": ["hot_air_inner", "cold_air_outer"],
+            "components": ["thermalCoupling"],
+        },
+    },
+}
+
+daOptionsThermal = {
+    "designSurfaces": ["channel_outer", "channel_inner", "channel_sides"],
+    "solverName": "DAHeatTransferFoam",
+    "primalMinResTol": 1.0e-12,
+    "primalMinResTolDiff": 1.0e12,
+    "discipline": "thermal",
+    "function": {
+        "HF_INNER": {
+            "type": "wallHeatFlux",
+            "source": "patchToFace",
+            "patches": ["channel_inner"],
+            "scale": 1,
+        },
+    },
+    "normalizeStates": {
+        "T": 300.0,
+    },
+    "inputInfo": {
+        "thermal_vol_coords": {"type": "volCoord", "components": ["solver", "function"]},
+        "q_conduct": {
+            "type": "thermalCouplingInput",
+            "patches": ["channel_outer", "channel_inner"],
+            "components": ["solver"],
+        },
+    },
+    "outputInfo": {
+        "T_conduct": {
+            "type": "thermalCouplingOutput",
+            "patches": ["channel_outer", "channel_inner"],
+            "components": ["thermalCoupling"],
+        },
+    },
+}
+
+# Mesh deformation setup
+meshOptions = {
+    "gridFile": os.getcwd(),
+    "fileType": "OpenFOAM",
+    # point and normal for the symmetry plane
+    "symmetryPlanes": [],
+}
+
+
+class Top(Multipoint):
+    def setup(self):
+
+        self.dafoam_builder_aero = DAFoamBuilder(
+            daOptionsAero, meshOptions, scenario="aerothermal", run_directory="aero"
+        )
+        self.dafoam_builder_aero.initialize(self.comm)
+
+        self.dafoam_builder_thermal = DAFoamBuilder(
+            daOptionsThermal, meshOptions, scenario="aerothermal", run_directory="thermal"
+        )
+        self.dafoam_builder_thermal.initialize(self.comm)
+
+        thermalxfer_builder = MeldThermalBuilder(self.dafoam_builder_aero, self.dafoam_builder_thermal, n=1, beta=0.5)
+        thermalxfer_builder.initialize(self.comm)
+
+        # add the mesh component
+        self.add_subsystem("mesh_aero", self.dafoam_builder_aero.get_mesh_coordinate_subsystem())
+        self.add_subsystem("mesh_thermal", self.dafoam_builder_thermal.get_mesh_coordinate_subsystem())
+
+        self.mphys_add_scenario(
+            "scenario",
+            ScenarioAeroThermal(
+                aero_builder=self.dafoam_builder_aero,
+                thermal_builder=self.dafoam_builder_thermal,
+                thermalxfer_builder=thermalxfer_builder,
+            ),
+            om.NonlinearBlockGS(maxiter=20, iprint=2, use_aitken=True, rtol=1e-8, atol=1e-14),
+            om.LinearBlockGS(maxiter=20, iprint=2, use_aitken=True, rtol=1e-8, atol=1e-14),
+        )
+
+        self.connect("mesh_aero.x_aero0", "scenario.x_aero")
+        self.connect("mesh_thermal.x_thermal0", "scenario.x_thermal")
+
+
+prob = om.Problem(reports=None)
+prob.model = Top()
+prob.setup(mode="rev")
+prob.run_model()
+
+solvers = {
+    "aero": [prob.model.dafoam_builder_aero.get_solver(), "aero"],
+    "thermal": [prob.model.dafoam_builder_thermal.get_solver(), "thermal"],
+}
+
+# fixed seeds so that the products are reproducible
+seeds = {}
+for discipline, (DASolver, runDir) in solvers.items():
+    np.random.seed(gcomm.rank + 100 * len(discipline))
+    seeds[discipline] = np.random.rand(DASolver.getNLocalAdjointStates())
+
+
+def calcResidualProduct(discipline):
+    """
+    Compute [dR/dW]^T * seed for the given discipline
+    """
+    DASolver, runDir = solvers[discipline]
+    with cd(runDir):
+        jacInputs = {"%s_states" % discipline: ["stateVar", DASolver.getStates()]}
+        products = DASolver.calcJacTVecProducts(jacInputs, "%s_residuals" % discipline, "residual", seeds[discipline])
+    return products["%s_states" % discipline]
+
+
+def calcRelDiff(product, productRef):
+    """
+    Compute the global relative difference between two products
+    """
+    diffNorm = np.sqrt(gcomm.allreduce(np.sum((product - productRef) ** 2), op=MPI.SUM))
+    refNorm = np.sqrt(gcomm.allreduce(np.sum(productRef**2), op=MPI.SUM))
+    return diffNorm / (refNorm + 1e-16)
+
+
+# the reference products, each recorded on a fresh tape
+refProducts = {}
+for discipline in solvers.keys():
+    refProducts[discipline] = calcResidualProduct(discipline)
+
+# interleave the two solvers. Each call finds the other solver's recording on the shared tape,
+# so the jacTVec tape must be re-recorded instead of reused
+for discipline in ["aero", "thermal", "aero", "thermal", "thermal", "aero"]:
+    relDiff = calcRelDiff(calcResidualProduct(discipline), refProducts[discipline])
+    if gcomm.rank == 0:
+        print("Interleaved jacTVec %s relDiff: %g" % (discipline, relDiff))
+    if relDiff > 1e-12:
+        if gcomm.rank == 0:
+            print("DAJacTVecTape test failed for the interleaved %s jacTVec product!" % discipline)
+        exit(1)
+
+if gcomm.rank == 0:
+    print("DAJacTVecTape test passed!")
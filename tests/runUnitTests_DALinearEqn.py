@@ -0,0 +1,114 @@
+#!/usr/bin/env python
+"""
+Run Python tests for DALinearEqn. We solve the adjoint equation for multiple right-hand sides
+using block GMRES and check that the solutions match the ones from solving the right-hand
+sides one by one. Two of the right-hand sides are nearly linearly dependent so the deflation
+in the block GMRES is tested
+"""
+
+from mpi4py import MPI
+from dafoam import PYDAFOAM
+from petsc4py import PETSc
+import os
+import numpy as np
+from testFuncs import *
+
+gcomm = MPI.COMM_WORLD
+
+os.chdir("./reg_test_files-main/ConvergentChannel")
+if gcomm.rank == 0:
+    os.system("rm -rf 0/* processor* *.bin")
+    os.system("cp -r 0.incompressible/* 0/")
+    os.system("cp -r system.incompressible/* system/")
+    os.system("cp -r constant/turbulenceProperties.sa constant/turbulenceProperties")
+
+gmresRelTol = 1.0e-10
+
+daOptions = {
+    "solverName": "DASimpleFoam",
+    "primalMinResTol": 1.0e-12,
+    "primalMinResTolDiff": 1e4,
+    "useAD": {"mode": "reverse"},
+    "primalBC": {
+        "U0": {"variable": "U", "patches": ["inlet"], "value": [10.0, 0.0, 0.0]},
+        "p0": {"variable": "p", "patches": ["outlet"], "value": [0.0]},
+        "nuTilda0": {"variable": "nuTilda", "patches": ["inlet"], "value": [4.5e-5]},
+        "useWallFunction": False,
+        "transport:nu": 1.5e-5,
+    },
+    "function": {
+        "CD": {
+            "type": "force",
+            "source": "patchToFace",
+            "patches": ["walls"],
+            "directionMode": "fixedDirection",
+            "direction": [1.0, 0.0, 0.0],
+            "scale": 1.0,
+        },
+    },
+    "adjEqnOption": {
+        "gmresRelTol": gmresRelTol,
+        "gmresAbsTol": 1.0e-16,
+        "pcFillLevel": 1,
+        "jacMatReOrdering": "rcm",
+    },
+    "normalizeStates": {"U": 10.0, "p": 50.0, "nuTilda": 1e-3, "phi": 1.0},
+}
+
+DASolver = PYDAFOAM(options=daOptions, comm=gcomm)
+DASolver()
+DASolver.setStates(DASolver.getStates())
+
+# set up the matrix-free dRdWT and the KSP, they are shared by the block and column-by-column solves
+DASolver.solverAD.initializedRdWTMatrixFree()
+dRdWTPC = PETSc.Mat().create(gcomm)
+DASolver.solver.calcdRdWT(1, dRdWTPC)
+ksp = PETSc.KSP().create(gcomm)
+DASolver.solverAD.createMLRKSPMatrixFree(dRdWTPC, ksp)
+
+# the right-hand sides. rhs2 is nearly parallel to rhs0 (its orthogonal part is below the
+# breakdown tolerance so it is deflated) and rhs3 is nearly parallel to rhs1 (its orthogonal
+# part is tiny but kept in the Krylov basis)
+localAdjSize = DASolver.getNLocalAdjointStates()
+np.random.seed(gcomm.rank)
+rhs0 = np.random.rand(localAdjSize)
+rhs1 = np.random.rand(localAdjSize) - 0.5
+rhs2 = 2.0 * rhs0 + 1.0e-14 * np.random.rand(localAdjSize)
+rhs3 = rhs1 + 1.0e-8 * np.random.rand(localAdjSize)
+rhsArrays = [rhs0, rhs1, rhs2, rhs3]
+
+# solve all the right-hand sides together using block GMRES
+fail, psiBlock, convergence = DASolver.solveLinearEqnBlock(ksp, rhsArrays)
+if fail:
+    if gcomm.rank == 0:
+        print("DALinearEqn test failed! Block GMRES did not converge: ", convergence)
+    exit(1)
+
+# solve the right-hand sides one by one using the same KSP
+psiColumns = []
+for rhsArray in rhsArrays:
+    rhs = DASolver.array2Vec(rhsArray)
+    psi = rhs.duplicate()
+    psi.zeroEntries()
+    fail = DASolver.solverAD.solveLinearEqn(ksp, rhs, psi)
+    if fail:
+        if gcomm.rank == 0:
+            print("DALinearEqn test failed! GMRES did not converge")
+        exit(1)
+    psiColumns.append(DASolver.vec2Array(psi))
+
+# both solves satisfy the residual tolerance gmresRelTol, so the solutions should match to gmresRelTol
+# up to the condition number of the preconditioned dRdWT
+for k in range(len(rhsArrays)):
+    diffNorm = np.sqrt(gcomm.allreduce(np.sum((psiBlock[k] - psiColumns[k]) ** 2), op=MPI.SUM))
+    refNorm = np.sqrt(gcomm.allreduce(np.sum(psiColumns[k] ** 2), op=MPI.SUM))
+    relDiff = diffNorm / refNorm
+    if gcomm.rank == 0:
+        print("RHS %d block iters: %d relDiff: %g" % (k, convergence[k]["iters"], relDiff))
+    if relDiff > 1.0e3 * gmresRelTol:
+        if gcomm.rank == 0:
+            print("DALinearEqn test failed! Block GMRES solution differs for RHS %d" % k)
+        exit(1)
+
+if gcomm.rank == 0:
+    print("DALinearEqn test passed!")
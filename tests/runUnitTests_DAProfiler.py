@@ -0,0 +1,247 @@
+#!/usr/bin/env python
+"""
+Run the profiling benchmarks for a few regression cases. We run the primal and adjoint
+with profiling active, record the phase times, tape memory, and KSP iterations to
+benchmark_xxx.json, and check that all the hot paths are profiled, the stats and the
+profile_xxx.json file have the expected structure with min <= mean <= max, and
+resetProfileStats zeros all the stats
+"""
+
+from mpi4py import MPI
+import os
+import json
+import copy
+import numpy as np
+from testFuncs import *
+
+import openmdao.api as om
+from mphys.multipoint import Multipoint
+from dafoam.mphys import DAFoamBuilder
+from mphys.scenario_aerodynamic import ScenarioAerodynamic
+
+gcomm = MPI.COMM_WORLD
+
+os.chdir("./reg_test_files-main/ConvergentChannel")
+
+# the phases and metrics that should be recorded by either solver or solverAD
+checkPhases = [
+    "primal",
+    "primalIteration",
+    "calcResiduals",
+    "tapeRecord",
+    "tapeEvaluate",
+    "coloring",
+    "fdColorLoop",
+    "kspSetup",
+    "kspSolve",
+    "stateTransfer",
+]
+checkMetrics = ["tapeMemoryMB", "tapeStatements", "kspIterations", "nColors"]
+# the keys for each stats entry
+statsKeys = ["min", "max", "mean"]
+
+daOptionsIncomp = {
+    "designSurfaces": ["walls"],
+    "solverName": "DASimpleFoam",
+    "primalMinResTol": 1.0e-12,
+    "primalMinResTolDiff": 1e4,
+    "useAD": {"mode": "reverse"},
+    "primalBC": {
+        "U0": {"variable": "U", "patches": ["inlet"], "value": [10.0, 0.0, 0.0]},
+        "p0": {"variable": "p", "patches": ["outlet"], "value": [0.0]},
+        "nuTilda0": {"variable": "nuTilda", "patches": ["inlet"], "value": [4.5e-5]},
+        "useWallFunction": False,
+        "transport:nu": 1.5e-5,
+    },
+    "function": {
+        "CD": {
+            "type": "force",
+            "source": "patchToFace",
+            "patches": ["walls"],
+            "directionMode": "fixedDirection",
+            "direction": [1.0, 0.0, 0.0],
+            "scale": 1.0,
+        },
+    },
+    "adjEqnOption": {"gmresRelTol": 1.0e-10, "pcFillLevel": 1, "jacMatReOrdering": "rcm"},
+    "normalizeStates": {"U": 10.0, "p": 50.0, "phi": 1.0, "nuTilda": 1e-3},
+    "inputInfo": {
+        "patchV": {
+            "type": "patchVelocity",
+            "patches": ["inlet"],
+            "flowAxis": "x",
+            "normalAxis": "y",
+            "components": ["solver", "function"],
+        },
+    },
+    "profiling": {"active": True, "writeJSON": True},
+}
+
+daOptionsComp = copy.deepcopy(daOptionsIncomp)
+daOptionsComp["solverName"] = "DARhoSimpleFoam"
+daOptionsComp["primalMinResTol"] = 1.0e-11
+daOptionsComp["useConstrainHbyA"] = False
+daOptionsComp["primalBC"] = {
+    "U0": {"variable": "U", "patches": ["inlet"], "value": [50.0, 0.0, 0.0]},
+    "p0": {"variable": "p", "patches": ["outlet"], "value": [101325.0]},
+    "nuTilda0": {"variable": "nuTilda", "patches": ["inlet"], "value": [4.5e-4]},
+    "useWallFunction": True,
+    "thermo:mu": 1.0e-5,
+}
+daOptionsComp["normalizeStates"] = {"U": 50.0, "p": 101325.0, "phi": 1.0, "nuTilda": 1e-3, "T": 300.0}
+
+
+def checkStats(caseName, stats, zero=False):
+    """
+    Check the structure of the stats from DASolver.getProfileStats, i.e.,
+    {"solver": {"nProcs": , "phases": {phase: {"time": {"min": , "max": , "mean": }, "count": {...}}},
+    "metrics": {metric: {"min": , "max": , "mean": }}}, "solverAD": {...}}, that min <= mean <= max,
+    and that all the values are zero if zero is True
+    """
+
+    def checkEntry(name, vals):
+        if sorted(vals.keys()) != sorted(statsKeys):
+            print("DAProfiler test failed for %s! %s has keys %s" % (caseName, name, str(sorted(vals.keys()))))
+            exit(1)
+        tol = 1e-12 * max(abs(vals["max"]), 1.0)
+        if vals["min"] > vals["mean"] + tol or vals["mean"] > vals["max"] + tol:
+            print("DAProfiler test failed for %s! %s does not satisfy min <= mean <= max: %s" % (caseName, name, vals))
+            exit(1)
+        if zero and max(abs(vals["min"]), abs(vals["max"]), abs(vals["mean"])) > 0:
+            print("DAProfiler test failed for %s! %s is not zero after resetProfileStats: %s" % (caseName, name, vals))
+            exit(1)
+
+    if "solver" not in stats.keys() or "solverAD" not in stats.keys():
+        print("DAProfiler test failed for %s! stats has keys %s" % (caseName, str(sorted(stats.keys()))))
+        exit(1)
+
+    for solverName in ["solver", "solverAD"]:
+        solverStats = stats[solverName]
+        for key in ["nProcs", "phases", "metrics"]:
+            if key not in solverStats.keys():
+                print("DAProfiler test failed for %s! %s stats has no %s!" % (caseName, solverName, key))
+                exit(1)
+        if solverStats["nProcs"] != gcomm.size:
+            print("DAProfiler test failed for %s! %s nProcs %d" % (caseName, solverName, solverStats["nProcs"]))
+            exit(1)
+        for phase in checkPhases:
+            if phase not in solverStats["phases"].keys():
+                print("DAProfiler test failed for %s! %s has no phase %s!" % (caseName, solverName, phase))
+                exit(1)
+        for phase, vals in solverStats["phases"].items():
+            if sorted(vals.keys()) != ["count", "time"]:
+                print("DAProfiler test failed for %s! %s phase %s has keys %s" % (caseName, solverName, phase, vals))
+                exit(1)
+            checkEntry("%s phase %s time" % (solverName, phase), vals["time"])
+            checkEntry("%s phase %s count" % (solverName, phase), vals["count"])
+        for metric in checkMetrics:
+            if metric not in solverStats["metrics"].keys():
+                print("DAProfiler test failed for %s! %s has no metric %s!" % (caseName, solverName, metric))
+                exit(1)
+        for metric, vals in solverStats["metrics"].items():
+            checkEntry("%s metric %s" % (solverName, metric), vals)
+
+
+def runBenchmark(caseName, daOptions, patchV):
+
+    class Top(Multipoint):
+        def setup(self):
+            dafoam_builder = DAFoamBuilder(daOptions, None, scenario="aerodynamic")
+            dafoam_builder.initialize(self.comm)
+
+            self.add_subsystem("dvs", om.IndepVarComp(), promotes=["*"])
+
+            self.mphys_add_scenario("cruise", ScenarioAerodynamic(aero_builder=dafoam_builder))
+
+        def configure(self):
+            self.dvs.add_output("patchV", val=np.array(patchV))
+            self.connect("patchV", "cruise.patchV")
+
+            self.add_design_var("patchV", lower=-100.0, upper=100.0, scaler=1.0)
+            self.add_objective("cruise.aero_post.CD", scaler=1.0)
+
+    prob = om.Problem()
+    prob.model = Top()
+    prob.setup(mode="rev")
+    om.n2(prob, show_browser=False, outfile="mphys_%s.html" % caseName)
+
+    prob.run_model()
+    prob.compute_totals()
+
+    DASolver = prob.model.cruise.coupling.solver.DASolver
+    stats = DASolver.getProfileStats()
+
+    if gcomm.rank == 0:
+        with open("benchmark_%s.json" % caseName, "w") as f:
+            json.dump(stats, f, indent=4, sort_keys=True)
+
+        print("Benchmark %s:" % caseName)
+        for solverName in sorted(stats.keys()):
+            for phase in sorted(stats[solverName]["phases"].keys()):
+                vals = stats[solverName]["phases"][phase]
+                print(
+                    "  %s %s: calls %d time (min/max/mean) %g / %g / %g s"
+                    % (
+                        solverName,
+                        phase,
+                        vals["count"]["max"],
+                        vals["time"]["min"],
+                        vals["time"]["max"],
+                        vals["time"]["mean"],
+                    )
+                )
+            for metric in sorted(stats[solverName]["metrics"].keys()):
+                vals = stats[solverName]["metrics"][metric]
+                print("  %s %s: %g" % (solverName, metric, vals["max"]))
+
+    checkStats(caseName, stats)
+
+    # the JSON file for the first optimization iteration should be written by mphys_dafoam.
+    # All the processors check it so that they exit together if it is wrong
+    gcomm.Barrier()
+    if not os.path.isfile("profile_001.json"):
+        print("DAProfiler test failed for %s! profile_001.json not found!" % caseName)
+        exit(1)
+    with open("profile_001.json", "r") as f:
+        statsJSON = json.load(f)
+    if statsJSON.pop("solutionCounter", None) != 1:
+        print("DAProfiler test failed for %s! profile_001.json has no solutionCounter 1!" % caseName)
+        exit(1)
+    checkStats(caseName + " profile_001.json", statsJSON)
+
+    for phase in checkPhases:
+        counts = [stats[s]["phases"][phase]["count"]["max"] for s in stats.keys()]
+        if max(counts) < 1:
+            print("DAProfiler test failed for %s! Phase %s not profiled!" % (caseName, phase))
+            exit(1)
+
+    for metric in checkMetrics:
+        vals = [stats[s]["metrics"][metric]["max"] for s in stats.keys()]
+        if max(vals) <= 0:
+            print("DAProfiler test failed for %s! Metric %s not recorded!" % (caseName, metric))
+            exit(1)
+
+    # resetProfileStats should zero all the phase times, counts, and metrics
+    DASolver.resetProfileStats()
+    checkStats(caseName + " resetProfileStats", DASolver.getProfileStats(), zero=True)
+
+    print("DAProfiler test passed for %s!" % caseName)
+
+
+if gcomm.rank == 0:
+    os.system("rm -rf 0/* processor* *.bin profile_*.json")
+    os.system("cp -r 0.incompressible/* 0/")
+    os.system("cp -r system.incompressible/* system/")
+    os.system("cp -r constant/turbulenceProperties.sa constant/turbulenceProperties")
+    replace_text_in_file("system/fvSchemes", "meshWave;", "meshWaveFrozen;")
+gcomm.Barrier()
+runBenchmark("DASimpleFoam", daOptionsIncomp, [10.0, 0.0])
+
+if gcomm.rank == 0:
+    os.system("rm -rf 0/* processor* *.bin profile_*.json")
+    os.system("cp -r 0.compressible/* 0/")
+    os.system("cp -r system.subsonic/* system/")
+    os.system("cp -r constant/turbulenceProperties.safv3 constant/turbulenceProperties")
+    replace_text_in_file("system/fvSchemes", "meshWave;", "meshWaveFrozen;")
+gcomm.Barrier()
+runBenchmark("DARhoSimpleFoam", daOptionsComp, [50.0, 0.0])
@@ -0,0 +1,153 @@
+#!/usr/bin/env python
+"""
+Run Python tests for the state transfers between the OpenFOAM fields and the adjoint vectors
+(DAIndex offset and stride tables). We run the primal and adjoint with adjStateOrdering = state
+and cell, check that both orderings give the same function and totals, and report the profiled
+stateTransfer times for both orderings in stateOrdering_xxx.json
+"""
+
+from mpi4py import MPI
+import os
+import copy
+import numpy as np
+from testFuncs import *
+
+import openmdao.api as om
+from mphys.multipoint import Multipoint
+from dafoam.mphys import DAFoamBuilder
+from mphys.scenario_aerodynamic import ScenarioAerodynamic
+
+gcomm = MPI.COMM_WORLD
+
+os.chdir("./reg_test_files-main/ConvergentChannel")
+if gcomm.rank == 0:
+    os.system("rm -rf 0/* processor* *.bin")
+    os.system("cp -r 0.incompressible/* 0/")
+    os.system("cp -r system.incompressible/* system/")
+    os.system("cp -r constant/turbulenceProperties.sa constant/turbulenceProperties")
+    replace_text_in_file("system/fvSchemes", "meshWave;", "meshWaveFrozen;")
+
+daOptions = {
+    "designSurfaces": ["walls"],
+    "solverName": "DASimpleFoam",
+    "primalMinResTol": 1.0e-12,
+    "primalMinResTolDiff": 1e4,
+    "primalBC": {
+        "U0": {"variable": "U", "patches": ["inlet"], "value": [10.0, 0.0, 0.0]},
+        "p0": {"variable": "p", "patches": ["outlet"], "value": [0.0]},
+        "nuTilda0": {"variable": "nuTilda", "patches": ["inlet"], "value": [4.5e-5]},
+        "useWallFunction": False,
+        "transport:nu": 1.5e-5,
+    },
+    "function": {
+        "CD": {
+            "type": "force",
+            "source": "patchToFace",
+            "patches": ["walls"],
+            "directionMode": "fixedDirection",
+            "direction": [1.0, 0.0, 0.0],
+            "scale": 1.0,
+        },
+    },
+    "adjEqnOption": {"gmresRelTol": 1.0e-10, "pcFillLevel": 1, "jacMatReOrdering": "rcm"},
+    "normalizeStates": {"U": 10.0, "p": 50.0, "phi": 1.0, "nuTilda": 1e-3},
+    "inputInfo": {
+        "patchV": {
+            "type": "patchVelocity",
+            "patches": ["inlet"],
+            "flowAxis": "x",
+            "normalAxis": "y",
+            "components": ["solver", "function"],
+        },
+    },
+    # we use the profiler to benchmark the state transfers
+    "profiling": {"active": True, "writeJSON": False},
+}
+
+
+def runOrdering(ordering):
+
+    options = copy.deepcopy(daOptions)
+    options["adjStateOrdering"] = ordering
+
+    class Top(Multipoint):
+        def setup(self):
+            dafoam_builder = DAFoamBuilder(options, None, scenario="aerodynamic")
+            dafoam_builder.initialize(self.comm)
+
+            self.add_subsystem("dvs", om.IndepVarComp(), promotes=["*"])
+
+            self.mphys_add_scenario("cruise", ScenarioAerodynamic(aero_builder=dafoam_builder))
+
+        def configure(self):
+            self.dvs.add_output("patchV", val=np.array([10.0, 0.0]))
+            self.connect("patchV", "cruise.patchV")
+
+            self.add_design_var("patchV", lower=-100.0, upper=100.0, scaler=1.0)
+            self.add_objective("cruise.aero_post.CD", scaler=1.0)
+
+    # the coloring and matrix files depend on the state ordering, so remove them
+    if gcomm.rank == 0:
+        os.system("rm -rf processor* *.bin")
+    gcomm.Barrier()
+
+    prob = om.Problem()
+    prob.model = Top()
+    prob.setup(mode="rev")
+    prob.run_model()
+    CD = prob.get_val("cruise.aero_post.CD")
+    totals = prob.compute_totals()
+
+    DASolver = prob.model.cruise.coupling.solver.DASolver
+    stats = DASolver.writeProfileJSON(0, "stateOrdering_%s.json" % ordering)
+
+    if gcomm.rank == 0:
+        print("adjStateOrdering %s: CD %.12f" % (ordering, CD[0]))
+        for solverName in sorted(stats.keys()):
+            if solverName not in ["solver", "solverAD"]:
+                continue
+            vals = stats[solverName]["phases"]["stateTransfer"]
+            print(
+                "  %s stateTransfer: calls %d time (min/mean/max) %g / %g / %g s"
+                % (solverName, vals["count"]["max"], vals["time"]["min"], vals["time"]["mean"], vals["time"]["max"])
+            )
+
+    # the state transfers should be profiled for both orderings
+    nCalls = max([stats[s]["phases"]["stateTransfer"]["count"]["max"] for s in ["solver", "solverAD"]])
+    if nCalls < 1:
+        print("DAStateOrdering test failed! stateTransfer not profiled for %s!" % ordering)
+        exit(1)
+
+    return CD, totals, stats
+
+
+CDState, totalsState, statsState = runOrdering("state")
+CDCell, totalsCell, statsCell = runOrdering("cell")
+
+# compare the state transfer times, the state ordering uses the memcpy bulk copies and the cell
+# ordering falls back to the strided copies
+if gcomm.rank == 0:
+    print("stateTransfer benchmark (mean time):")
+    for solverName in ["solver", "solverAD"]:
+        print(
+            "  %s state: %g s cell: %g s"
+            % (
+                solverName,
+                statsState[solverName]["phases"]["stateTransfer"]["time"]["mean"],
+                statsCell[solverName]["phases"]["stateTransfer"]["time"]["mean"],
+            )
+        )
+
+# the ordering only changes where the states are stored in the adjoint vectors
+if abs(CDState[0] - CDCell[0]) / (abs(CDState[0]) + 1e-16) > 1e-10:
+    print("DAStateOrdering test failed! CD differs for state and cell orderings!")
+    exit(1)
+
+for key in totalsState.keys():
+    diff = np.max(np.abs(totalsState[key] - totalsCell[key]))
+    ref = max(np.max(np.abs(totalsState[key])), 1e-16)
+    if diff / ref > 1e-8:
+        print("DAStateOrdering test failed! Totals differ for state and cell orderings: %s" % str(key))
+        exit(1)
+
+print("DAStateOrdering test passed!")
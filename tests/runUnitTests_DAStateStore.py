@@ -0,0 +1,95 @@
+#!/usr/bin/env python
+"""
+Run Python tests for the unsteady state storage (file, memory, and checkpoint)
+"""
+
+from mpi4py import MPI
+from dafoam import PYDAFOAM
+import os
+import copy
+import numpy as np
+from testFuncs import *
+
+gcomm = MPI.COMM_WORLD
+
+os.chdir("./reg_test_files-main/ConvergentChannel")
+if gcomm.rank == 0:
+    os.system("rm -rf 0/* processor* *.bin")
+    os.system("cp -r 0.incompressible/* 0/")
+    os.system("cp -r system.incompressible.unsteady/* system/")
+    os.system("cp -r constant/turbulenceProperties.sa constant/turbulenceProperties")
+    replace_text_in_file("system/fvSchemes", "meshWave;", "meshWaveFrozen;")
+
+daOptions = {
+    "solverName": "DAPimpleFoam",
+    "primalBC": {
+        "useWallFunction": False,
+    },
+    "unsteadyAdjoint": {
+        "mode": "timeAccurate",
+        "readZeroFields": True,
+    },
+}
+
+
+def getStateSnapshots(stateStorage, compression="none", nCheckpoints=20):
+    """
+    Run the primal with the prescribed state storage and read the states back
+    for all time instances, from the last to the first like the unsteady adjoint
+    """
+    options = copy.deepcopy(daOptions)
+    options["unsteadyAdjoint"]["stateStorage"] = stateStorage
+    options["unsteadyAdjoint"]["stateStorageCompression"] = compression
+    options["unsteadyAdjoint"]["nStateCheckpoints"] = nCheckpoints
+
+    DASolver = PYDAFOAM(options=options, comm=gcomm)
+    DASolver()
+
+    deltaT = DASolver.solver.getDeltaT()
+    endTimeIndex = round(DASolver.solver.getEndTime() / deltaT)
+    snapshotSize = DASolver.solver.getStateSnapshotSize()
+
+    snapshots = {}
+    for n in range(endTimeIndex, 0, -1):
+        DASolver.solver.setTime(n * deltaT, n)
+        DASolver.solver.readStateVars(n * deltaT, 0)
+        snapshots[n] = np.zeros(snapshotSize)
+        DASolver.solver.getStateSnapshot(snapshots[n], 0)
+
+    DASolver.solver.printStateStoreStats()
+
+    return snapshots
+
+
+def checkSnapshots(name, snapshots, snapshotsRef, tol):
+    maxRelErr = 0.0
+    for n in snapshotsRef.keys():
+        err = np.max(np.abs(snapshots[n] - snapshotsRef[n]))
+        ref = max(np.max(np.abs(snapshotsRef[n])), 1e-16)
+        maxRelErr = max(maxRelErr, err / ref)
+    maxRelErr = gcomm.allreduce(maxRelErr, op=MPI.MAX)
+    if gcomm.rank == 0:
+        print(name, "max relative error", maxRelErr)
+    if maxRelErr > tol:
+        print("DAStateStore test failed for %s!" % name)
+        exit(1)
+    else:
+        print("DAStateStore test passed for %s!" % name)
+
+
+snapshotsMemory = getStateSnapshots("memory")
+
+# the file store writes ascii fields so we can only check it with a loose tolerance
+snapshotsFile = getStateSnapshots("file")
+checkSnapshots("file", snapshotsFile, snapshotsMemory, 1e-5)
+
+snapshotsFloat = getStateSnapshots("memory", compression="float")
+checkSnapshots("float", snapshotsFloat, snapshotsMemory, 1e-6)
+
+# the quantized error is bounded by stateStorageRelTol (1e-6) for each block
+snapshotsQuantized = getStateSnapshots("memory", compression="quantized")
+checkSnapshots("quantized", snapshotsQuantized, snapshotsMemory, 1e-6)
+
+# recomputing the states from checkpoints should give the same states as the memory store
+snapshotsCheckpoint = getStateSnapshots("checkpoint", nCheckpoints=2)
+checkSnapshots("checkpoint", snapshotsCheckpoint, snapshotsMemory, 1e-10)